@@ -0,0 +1,202 @@
+; libbigasm: long arithmetic routines from add.asm, sub.asm and mul.asm
+; rewritten as System V AMD64 ABI functions (see bigasm.h)
+;
+; long numbers are arrays of qwords, least significant first;
+; arguments come in rdi, rsi, rdx, rcx, r8, result in rax,
+; rbx and r12-r15 are preserved
+
+                section         .text
+
+                global          bigasm_add_n
+                global          bigasm_sub_n
+                global          bigasm_mul_1
+                global          bigasm_addmul_1
+                global          bigasm_divrem_1
+                global          bigasm_mul_basecase
+
+; adds two long numbers (add_long_long)
+;    rdi -- address of sum (may be equal to rsi or rdx)
+;    rsi -- address of summand #1 (long number)
+;    rdx -- address of summand #2 (long number)
+;    rcx -- length of long numbers in qwords
+; result:
+;    rax -- carry (0 or 1)
+bigasm_add_n:
+                xor             eax, eax
+                test            rcx, rcx
+                jz              .done
+
+.loop:
+                mov             r8, [rsi]
+                adc             r8, [rdx]
+                mov             [rdi], r8
+                lea             rsi, [rsi + 8]
+                lea             rdx, [rdx + 8]
+                lea             rdi, [rdi + 8]
+                dec             rcx
+                jnz             .loop
+
+                setc            al
+.done:
+                ret
+
+; subtracts two long numbers (sub_long_long)
+;    rdi -- address of difference (may be equal to rsi or rdx)
+;    rsi -- address of minuend (long number)
+;    rdx -- address of subtrahend (long number)
+;    rcx -- length of long numbers in qwords
+; result:
+;    rax -- borrow (0 or 1)
+bigasm_sub_n:
+                xor             eax, eax
+                test            rcx, rcx
+                jz              .done
+
+.loop:
+                mov             r8, [rsi]
+                sbb             r8, [rdx]
+                mov             [rdi], r8
+                lea             rsi, [rsi + 8]
+                lea             rdx, [rdx + 8]
+                lea             rdi, [rdi + 8]
+                dec             rcx
+                jnz             .loop
+
+                setc            al
+.done:
+                ret
+
+; multiplies long number by a short (mul_long_short)
+;    rdi -- address of product (may be equal to rsi)
+;    rsi -- address of multiplier #1 (long number)
+;    rdx -- length of long number in qwords
+;    rcx -- multiplier #2 (64-bit unsigned)
+; result:
+;    rax -- most significant qword of the product
+bigasm_mul_1:
+                mov             r8, rdx
+                xor             r9, r9
+                test            r8, r8
+                jz              .done
+
+.loop:
+                mov             rax, [rsi]
+                mul             rcx
+                add             rax, r9
+                adc             rdx, 0
+                mov             [rdi], rax
+                mov             r9, rdx
+                lea             rsi, [rsi + 8]
+                lea             rdi, [rdi + 8]
+                dec             r8
+                jnz             .loop
+
+.done:
+                mov             rax, r9
+                ret
+
+; adds product of long number and a short to long number
+;    rdi -- address of summand (long number), sum is written here
+;    rsi -- address of multiplier #1 (long number)
+;    rdx -- length of long numbers in qwords
+;    rcx -- multiplier #2 (64-bit unsigned)
+; result:
+;    rax -- carry out of the most significant qword
+bigasm_addmul_1:
+                mov             r8, rdx
+                xor             r9, r9
+                test            r8, r8
+                jz              .done
+
+.loop:
+                mov             rax, [rsi]
+                mul             rcx
+                add             rax, r9
+                adc             rdx, 0
+                add             [rdi], rax
+                adc             rdx, 0
+                mov             r9, rdx
+                lea             rsi, [rsi + 8]
+                lea             rdi, [rdi + 8]
+                dec             r8
+                jnz             .loop
+
+.done:
+                mov             rax, r9
+                ret
+
+; divides long number by a short (div_long_short)
+;    rdi -- address of quotient (may be equal to rsi)
+;    rsi -- address of dividend (long number)
+;    rdx -- length of long number in qwords
+;    rcx -- divisor (64-bit unsigned, nonzero)
+; result:
+;    rax -- remainder
+bigasm_divrem_1:
+                mov             r8, rdx
+                xor             edx, edx
+                test            r8, r8
+                jz              .done
+
+.loop:
+                mov             rax, [rsi + 8 * r8 - 8]
+                div             rcx
+                mov             [rdi + 8 * r8 - 8], rax
+                dec             r8
+                jnz             .loop
+
+.done:
+                mov             rax, rdx
+                ret
+
+; multiplies two long numbers (mul_long_long), one row per qword of
+; the shorter multiplier
+;    rdi -- address of product, rdx + r8 qwords, must not overlap multipliers
+;    rsi -- address of multiplier #1 (long number)
+;    rdx -- length of multiplier #1 in qwords, nonzero
+;    rcx -- address of multiplier #2 (long number)
+;    r8  -- length of multiplier #2 in qwords, nonzero
+bigasm_mul_basecase:
+                push            rbx
+                push            r12
+                push            r13
+                push            r14
+                push            r15
+
+                cmp             rdx, r8
+                jae             .ordered
+                xchg            rsi, rcx
+                xchg            rdx, r8
+.ordered:
+                mov             r12, rdi
+                mov             r13, rsi
+                mov             r14, rdx
+                mov             r15, rcx
+                mov             rbx, r8
+
+                mov             rcx, [r15]
+                call            bigasm_mul_1 wrt ..plt
+                mov             [r12 + 8 * r14], rax
+
+.loop:
+                dec             rbx
+                jz              .done
+                lea             r15, [r15 + 8]
+                lea             r12, [r12 + 8]
+                mov             rdi, r12
+                mov             rsi, r13
+                mov             rdx, r14
+                mov             rcx, [r15]
+                call            bigasm_addmul_1 wrt ..plt
+                mov             [r12 + 8 * r14], rax
+                jmp             .loop
+
+.done:
+                pop             r15
+                pop             r14
+                pop             r13
+                pop             r12
+                pop             rbx
+                ret
+
+                section         .note.GNU-stack noalloc noexec nowrite progbits
@@ -0,0 +1,39 @@
+#ifndef BIGASM_H
+#define BIGASM_H
+
+/*
+ * libbigasm -- long arithmetic routines from bigasm.asm, System V AMD64 ABI.
+ * Long numbers are arrays of 64-bit limbs, least significant first.
+ * Lengths may be zero unless stated otherwise
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* r[0, n) = a[0, n) + b[0, n), returns carry; r may be equal to a or b */
+uint64_t bigasm_add_n(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n);
+
+/* r[0, n) = a[0, n) - b[0, n), returns borrow; r may be equal to a or b */
+uint64_t bigasm_sub_n(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n);
+
+/* r[0, n) = a[0, n) * b, returns the most significant limb; r may be equal to a */
+uint64_t bigasm_mul_1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b);
+
+/* r[0, n) += a[0, n) * b, returns carry */
+uint64_t bigasm_addmul_1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b);
+
+/* q[0, n) = a[0, n) / d, returns remainder; d != 0, q may be equal to a */
+uint64_t bigasm_divrem_1(uint64_t* q, const uint64_t* a, size_t n, uint64_t d);
+
+/* r[0, an + bn) = a[0, an) * b[0, bn); an, bn >= 1, r does not overlap a and b */
+void bigasm_mul_basecase(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b, size_t bn);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -3,39 +3,35 @@
 #include <cassert>
 #include <algorithm>
 #include <tuple>
+#include <cstring>
+#include <istream>
+#include <ostream>
 #include "big_integer.h"
+#include "limb_mul.h"
+#include "limb_ops.h"
+#include "thread_pool.h"
 
-const uint64_t MAX_DIGIT = std::numeric_limits<uint64_t>::max();
-const uint64_t BASE_POWER2 = 64;
+using limb_t = big_integer::limb_type;
 
-const big_integer ZERO;
+const limb_t MAX_DIGIT = std::numeric_limits<limb_t>::max();
+const uint64_t BASE_POWER2 = std::numeric_limits<limb_t>::digits;
 
-static bool add_overflow_(uint64_t left, uint64_t right, bool carry = false) {
-    return left > MAX_DIGIT - right || (carry && left + right == MAX_DIGIT);
-}
+const big_integer ZERO;
 
-static bool sub_overflow_(uint64_t left, uint64_t right, bool carry = false) {
-    return left < right || (carry && left == right);
-}
+const size_t DIGITS_COUNT = big_integer::limb_traits::DIGITS_COUNT;
+const limb_t POWER_10_DIGITS = big_integer::limb_traits::POWER_10_DIGITS;  // 10^DIGITS_COUNT
 
-static uint64_t mul_overflow_(uint64_t left, uint64_t right) {
-    uint64_t upper, lower;
-    __asm__("mulq %3;"
-    : "=a" (lower), "=d" (upper)
-    : "a" (left), "r" (right));
-    return upper;
+// if upper_left >= right || right == 0 then UB
+static std::pair<limb_t, limb_t> div_mod_(limb_t upper_left, limb_t lower_left, limb_t right) {
+    return big_integer::limb_traits::div_mod(upper_left, lower_left, right);
 }
 
-// if upper_left >= right || right == 0 then UB
-static std::pair<uint64_t, uint64_t> div_mod_(uint64_t upper_left, uint64_t lower_left, uint64_t right) {
-    uint64_t result, modulo;
-    __asm__("divq %4;"
-    : "=a" (result), "=d" (modulo)
-    : "a" (lower_left), "d" (upper_left), "r" (right));
-    return {result, modulo};
+// число значащих бит цифры
+static size_t digit_length_(limb_t digit) {
+    return 64 - __builtin_clzll(digit);
 }
 
-static uint64_t soft_div(uint64_t upper_left, uint64_t lower_left, uint64_t right) {
+static limb_t soft_div(limb_t upper_left, limb_t lower_left, limb_t right) {
     assert(right != 0);
     if (upper_left >= right) {
         return MAX_DIGIT;
@@ -43,6 +39,14 @@ static uint64_t soft_div(uint64_t upper_left, uint64_t lower_left, uint64_t righ
     return div_mod_(upper_left, lower_left, right).first;
 }
 
+static int native_endian_() {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return 1;
+#else
+    return -1;
+#endif
+}
+
 static uint64_t iabs_(const int& x) {
     return x >= 0 ? static_cast<unsigned>(x) : -static_cast<unsigned>(x);
 }
@@ -56,55 +60,48 @@ static uint64_t llabs_(const long long& x) {
 }
 
 big_integer::big_integer() :
-        data_(1, 0ULL), sign_(false) { }
+        data_(1, 0), sign_(false) { }
 
 big_integer::big_integer(const int& val) :
-        data_(1, iabs_(val)), sign_(val < 0) { }
+        data_(digits_of_(iabs_(val))), sign_(val < 0) { }
 
 big_integer::big_integer(const long& val) :
-        data_(1, labs_(val)), sign_(val < 0) { }
+        data_(digits_of_(labs_(val))), sign_(val < 0) { }
 
 big_integer::big_integer(const long long& val) :
-        data_(1, llabs_(val)), sign_(val < 0) { }
+        data_(digits_of_(llabs_(val))), sign_(val < 0) { }
 
 big_integer::big_integer(const unsigned& val) :
-        data_(1, val), sign_(false) { }
+        data_(digits_of_(val)), sign_(false) { }
 
 big_integer::big_integer(const unsigned long& val) :
-        data_(1, val), sign_(false) { }
+        data_(digits_of_(val)), sign_(false) { }
 
 big_integer::big_integer(const unsigned long long& val) :
-        data_(1, val), sign_(false) { }
+        data_(digits_of_(val)), sign_(false) { }
 
 
-big_integer::big_integer(const std::string& str) {
-    sign_ = false;
+big_integer::big_integer(const std::string& str) : big_integer() {
     size_t i = str[0] == '-' || str[0] == '+';
     bool new_sign = str[0] == '-';
 
-    const int DIGITS_COUNT = 19;  // 19 -- max power of 10 less than 2^64
-    const uint64_t POWER_10_DIGITS = 10000000000000000000ULL;  // 10^19 -- max power of 10 less than 2^64
-    uint64_t buf = 0ULL;
+    // log2(10) < 10 / 3, так что цифр числа не больше, чем столько
+    data_.reserve((str.size() - i) * 10 / 3 / BASE_POWER2 + 2);
+
+    uint64_t buf = 0ULL, power_10 = 1ULL;
     size_t cur_cnt = 0;
-    while (i != str.size()) {
-        while (i != str.size() && cur_cnt < DIGITS_COUNT) {
-            buf = buf * 10ULL + static_cast<uint64_t>(str[i] - '0');
-            i++;
-            cur_cnt++;
-        }
-        if (cur_cnt == DIGITS_COUNT) {
+    for (; i != str.size(); i++) {
+        buf = buf * 10ULL + static_cast<uint64_t>(str[i] - '0');
+        power_10 *= 10ULL;
+        if (++cur_cnt == DIGITS_COUNT) {
+            mul_add_short_(power_10, buf);
+            buf = 0ULL;
+            power_10 = 1ULL;
             cur_cnt = 0;
-            (*this) *= POWER_10_DIGITS;
-        } else {
-            uint64_t current_power_10 = 1LL;
-            while (cur_cnt > 0) {
-                cur_cnt--;
-                current_power_10 *= 10;
-            }
-            (*this) *= current_power_10;
         }
-        (*this) += buf;
-        buf = 0ULL;
+    }
+    if (cur_cnt > 0) {
+        mul_add_short_(power_10, buf);
     }
     set_sign_(new_sign);
 }
@@ -115,6 +112,172 @@ bool big_integer::sign() const {
 }
 
 
+// число значащих бит в дополнительном коде, не считая знакового
+size_t big_integer::bit_length() const {
+    if (data_.back() == 0) {
+        return 0;
+    }
+    size_t result = (data_.size() - 1) * BASE_POWER2 + digit_length_(data_.back());
+    // -2^k == ~(2^k - 1) помещается на один бит короче
+    if (sign() && ctz() == result - 1) {
+        --result;
+    }
+    return result;
+}
+
+
+// для отрицательных -- число бит, отличных от знакового
+size_t big_integer::popcount() const {
+    size_t result = 0;
+    for (limb_t digit : data_) {
+        result += __builtin_popcountll(digit);
+    }
+    // ~(-m) == m - 1: младшая единица m пропадает, нули под ней становятся единицами
+    return sign() ? result - 1 + ctz() : result;
+}
+
+
+// число нулей в младших разрядах, для нуля возвращается 0
+size_t big_integer::ctz() const {
+    for (size_t i = 0; i < data_.size(); i++) {
+        if (data_[i] != 0) {
+            return i * BASE_POWER2 + __builtin_ctzll(data_[i]);
+        }
+    }
+    return 0;
+}
+
+
+bool big_integer::test_bit(size_t pos) const {
+    size_t digit = pos / BASE_POWER2;
+    bool bit = digit < data_.size() && (data_[digit] >> pos % BASE_POWER2 & 1U);
+    if (!sign()) {
+        return bit;
+    }
+    // -m == ~(m - 1): ниже младшей единицы m нули, сама она сохраняется, выше биты инвертируются
+    size_t low = ctz();
+    return pos <= low ? pos == low : !bit;
+}
+
+
+big_integer& big_integer::set_bit(size_t pos) {
+    if (sign()) {
+        return (*this) |= big_integer(1) << pos;
+    }
+    size_t digit = pos / BASE_POWER2;
+    if (digit >= data_.size()) {
+        data_.resize(digit + 1);
+    }
+    data_[digit] |= static_cast<limb_t>(1) << pos % BASE_POWER2;
+    return (*this);
+}
+
+
+big_integer& big_integer::clear_bit(size_t pos) {
+    if (sign()) {
+        return (*this) &= ~(big_integer(1) << pos);
+    }
+    size_t digit = pos / BASE_POWER2;
+    if (digit < data_.size()) {
+        data_[digit] &= ~(static_cast<limb_t>(1) << pos % BASE_POWER2);
+        keep_invariant_();
+    }
+    return (*this);
+}
+
+
+size_t big_integer::hash() const {
+    size_t result = data_.hash();
+    return sign() ? ~result : result;
+}
+
+
+size_t big_integer::export_size(size_t size) const {
+    assert(size != 0);
+    size_t bits = data_.back() == 0 ? 0 : (data_.size() - 1) * BASE_POWER2 + digit_length_(data_.back());
+    return (bits + 8 * size - 1) / (8 * size);
+}
+
+
+size_t big_integer::export_limbs(void* dest, int order, size_t size, int endian) const {
+    size_t count = export_size(size);
+    endian = endian == 0 ? native_endian_() : endian;
+    if (size == sizeof(limb_t) && order == -1 && endian == native_endian_()) {
+        std::memcpy(dest, data_.begin(), count * size);
+        return count;
+    }
+    auto* out = static_cast<unsigned char*>(dest);
+    for (size_t k = 0; k < count; k++) {
+        unsigned char* word = out + (order == -1 ? k : count - 1 - k) * size;
+        for (size_t b = 0; b < size; b++) {
+            size_t idx = k * size + b;
+            size_t digit = idx / sizeof(limb_t);
+            limb_t byte = digit < data_.size() ? data_[digit] >> 8 * (idx % sizeof(limb_t)) : 0;
+            word[endian == -1 ? b : size - 1 - b] = static_cast<unsigned char>(byte);
+        }
+    }
+    return count;
+}
+
+
+big_integer& big_integer::import_limbs(const void* src, size_t count, int order, size_t size, int endian,
+                                       bool negative) {
+    assert(size != 0);
+    endian = endian == 0 ? native_endian_() : endian;
+    data_ = storage_type(std::max<size_t>(1, (count * size + sizeof(limb_t) - 1) / sizeof(limb_t)), 0);
+    if (size == sizeof(limb_t) && order == -1 && endian == native_endian_()) {
+        std::memcpy(data_.begin(), src, count * size);
+    } else {
+        auto* in = static_cast<const unsigned char*>(src);
+        for (size_t k = 0; k < count; k++) {
+            const unsigned char* word = in + (order == -1 ? k : count - 1 - k) * size;
+            for (size_t b = 0; b < size; b++) {
+                size_t idx = k * size + b;
+                limb_t byte = word[endian == -1 ? b : size - 1 - b];
+                data_[idx / sizeof(limb_t)] |= byte << 8 * (idx % sizeof(limb_t));
+            }
+        }
+    }
+    sign_ = negative;
+    keep_invariant_();
+    return (*this);
+}
+
+
+const limb_t* big_integer::limbs() const {
+    return data_.begin();
+}
+
+
+size_t big_integer::limb_count() const {
+    return data_.size();
+}
+
+
+big_integer big_integer::view(const limb_t* limbs, size_t count, bool negative,
+                              std::shared_ptr<const void> owner) {
+    while (count > 0 && limbs[count - 1] == 0) {
+        --count;
+    }
+    big_integer result;
+    if (count > 0) {
+        result.data_ = storage_type::view(limbs, count, std::move(owner));
+    }
+    result.set_sign_(negative);
+    return result;
+}
+
+
+big_integer::storage_type big_integer::digits_of_(uint64_t val) {
+    storage_type result(1, static_cast<limb_t>(val));
+    // сдвиг в два шага: при 64-битной цифре сдвиг на 64 -- UB
+    for (val = val >> (BASE_POWER2 - 1) >> 1; val != 0; val = val >> (BASE_POWER2 - 1) >> 1) {
+        result.push_back(static_cast<limb_t>(val));
+    }
+    return result;
+}
+
+
 void big_integer::set_sign_(bool new_sign) {
     sign_ = (data_.size() != 1 || data_[0] != 0) && new_sign;
 }
@@ -125,56 +288,264 @@ void big_integer::switch_sign_() {
 }
 
 
-big_integer big_integer::abs_() const {
-    return sign() ? -(*this) : (*this);
+// сравнение модулей без учёта знаков
+int big_integer::compare_abs_(const big_integer& right) const {
+    size_t left_size = data_.size(), right_size = right.data_.size();
+    if (left_size != right_size) {
+        return left_size < right_size ? -1 : 1;
+    }
+    return limb_cmp(data_.cbegin(), right.data_.cbegin(), left_size);
 }
 
 
-uint64_t big_integer::div_short_(uint64_t right) {
+limb_t big_integer::div_short_(limb_t right) {
     assert(right != 0);
-    uint64_t carry = 0;
-    for (size_t i = data_.size(); i --> 0; ) {
-        std::tie(data_[i], carry) = div_mod_(carry, data_[i], right);
-    }
+    limb_t* digits = data_.make_unique();
+    limb_t rem = limb_divrem_1<limb_t, limb_traits>(digits, digits, data_.size(), right);
     keep_invariant_();
-    return carry;
+    return rem;
 }
 
 
-void big_integer::two_complement_() {
-    if (sign()) {
-        ++(*this);
-        for (uint64_t& i : data_) {
-            i = ~i;
+// (*this) = (*this) * mul + add, без временных объектов
+void big_integer::mul_add_short_(limb_t mul, limb_t add) {
+    std::pair<limb_t*, size_t> digits = data_.mutable_span();
+    limb_t carry = limb_mul_1(digits.first, digits.first, digits.second, mul);
+    carry += limb_add_1(digits.first, digits.first, digits.second, add);
+    if (carry != 0) {
+        data_.push_back(carry);
+    }
+}
+
+
+/*
+ * Перевод в десятичную систему. Короткие числа делятся на 10^DIGITS_COUNT
+ * по одной цифре, длинные -- деревом: число из count блоков делится с
+ * остатком на 10^(DIGITS_COUNT * h), h = ceil(count / 2), и половины блоков
+ * считаются независимо (при нескольких потоках -- в пуле, см. thread_pool.h),
+ * каждая сразу на своё место в массиве блоков. Деление -- по Барретту,
+ * через заранее посчитанные обратные к степеням, так что вся работа
+ * сводится к умножениям из limb_mul.h
+ */
+const size_t DECIMAL_TREE_MIN_LIMBS = 80;
+const size_t DECIMAL_BASECASE_LIMBS = 32;
+const size_t PARALLEL_DECIMAL_MIN_LIMBS = 512;
+const size_t PARALLEL_RENDER_MIN_CHUNKS = size_t(1) << 16;
+
+/*
+ * Степени для дерева уровня levels: узел уровня k содержит не больше
+ * chunks[k] блоков, chunks[k] = ceil(chunks[k + 1] / 2), chunks[0] = 1.
+ * powers[k] = 10^(DIGITS_COUNT * chunks[k]), inverses[k] ~ 2^(2n) / powers[k],
+ * n -- длина powers[k] в битах. Обратные считаются только к тем степеням,
+ * на которые дерево действительно делит
+ */
+struct big_integer::decimal_powers_ {
+    std::vector<size_t> chunks;
+    std::vector<big_integer> powers;
+    std::vector<big_integer> inverses;
+};
+
+
+// приближение к 2^(2n) / p с ошибкой в несколько единиц, n -- длина p > 0 в битах;
+// итерация Ньютона от обратного к старшей половине p
+static big_integer reciprocal_(const big_integer& p) {
+    size_t n = p.bit_length();
+    big_integer power_2n = big_integer(1) << 2 * n;
+    if (n <= DECIMAL_BASECASE_LIMBS * BASE_POWER2) {
+        return power_2n / p;
+    }
+    // x0 = xh * 2^(n - k), x = x0 + x0 * (2^(2n) - p * x0) / 2^(2n): относительная погрешность
+    // возводится в квадрат, а в умножениях участвует только xh длины k
+    size_t k = n / 2 + 1;
+    big_integer xh = reciprocal_(p >> (n - k));
+    big_integer e = power_2n - ((p * xh) << (n - k));
+    return (xh << (n - k)) + ((xh * e) >> (n + k));
+}
+
+
+// модуль числа по основанию 10^DIGITS_COUNT, младшие блоки первыми
+std::vector<limb_t> big_integer::decimal_chunks_() const {
+    std::vector<limb_t> chunks;
+    if (data_.size() < DECIMAL_TREE_MIN_LIMBS) {
+        chunks.reserve(data_.size() * BASE_POWER2 / (3 * DIGITS_COUNT) + 1);  // 10^k > 2^(3k)
+        big_integer rest(*this);
+        do {
+            chunks.push_back(rest.div_short_(POWER_10_DIGITS));
+        } while (rest.data_.size() > 1 || rest.data_[0] != 0);
+        return chunks;
+    }
+
+    // десятичных цифр не больше bits * lg 2 + 1, lg 2 < 0.30103
+    uint64_t bits = (data_.size() - 1) * BASE_POWER2 + digit_length_(data_.back());
+    size_t count = static_cast<size_t>((bits * 30103 / 100000 + 1) / DIGITS_COUNT + 1);
+
+    decimal_powers_ powers;
+    for (size_t c = count; c > 1; c = (c + 1) / 2) {
+        powers.chunks.push_back(c);
+    }
+    powers.chunks.push_back(1);
+    std::reverse(powers.chunks.begin(), powers.chunks.end());
+    size_t level = powers.chunks.size() - 1;
+    for (size_t k = 0; k < level; k++) {
+        if (k == 0) {
+            powers.powers.push_back(POWER_10_DIGITS);
+        } else {
+            big_integer power = powers.powers.back() * powers.powers.back();
+            if (powers.chunks[k] < 2 * powers.chunks[k - 1]) {
+                power.div_short_(POWER_10_DIGITS);
+            }
+            powers.powers.push_back(power);
         }
+        // узлы, делящиеся на powers[k], не длиннее двух powers[k], а до DECIMAL_BASECASE_LIMBS дерево не делит
+        bool used = 2 * powers.powers.back().data_.size() > DECIMAL_BASECASE_LIMBS;
+        powers.inverses.push_back(used ? reciprocal_(powers.powers.back()) : big_integer());
+    }
+
+    chunks.resize(count);
+    big_integer abs(*this);
+    abs.sign_ = false;
+    abs.decimal_tree_(level, count, chunks.data(), powers);
+    while (chunks.size() > 1 && chunks.back() == 0) {
+        chunks.pop_back();
     }
+    return chunks;
 }
 
 
-big_integer& big_integer::apply_bitwise_(const std::function<uint64_t(uint64_t, uint64_t)>& f, big_integer right) {
-    size_t sz = std::max(data_.size(), right.data_.size());
-    bool new_sign = static_cast<bool>(f(sign(), right.sign()) & 1ULL);
+// chunks[0, count) = блоки (*this), 0 <= (*this) < 10^(DIGITS_COUNT * count), count <= powers.chunks[level]
+void big_integer::decimal_tree_(size_t level, size_t count, limb_t* chunks, const decimal_powers_& powers) const {
+    if (level == 0 || data_.size() <= DECIMAL_BASECASE_LIMBS) {
+        big_integer rest(*this);
+        size_t i = 0;
+        while (i < count && (rest.data_.size() > 1 || rest.data_[0] != 0)) {
+            chunks[i++] = rest.div_short_(POWER_10_DIGITS);
+        }
+        std::fill(chunks + i, chunks + count, limb_t(0));
+        return;
+    }
+    size_t half = powers.chunks[level - 1];
+    const big_integer& power = powers.powers[level - 1];
+    if (count <= half || compare_abs_(power) < 0) {
+        decimal_tree_(level - 1, std::min(count, half), chunks, powers);
+        std::fill(chunks + std::min(count, half), chunks + count, limb_t(0));
+        return;
+    }
+
+    // частное по усечённому делимому и приближённому обратному отличается от точного на несколько единиц
+    size_t bits = power.bit_length();
+    big_integer high = ((*this >> (bits - 1)) * powers.inverses[level - 1]) >> (bits + 1);
+    big_integer low = *this - high * power;
+    while (low.sign()) {
+        low += power;
+        high -= 1;
+    }
+    while (low >= power) {
+        low -= power;
+        high += 1;
+    }
+
+    thread_pool::task_group group(data_.size() >= PARALLEL_DECIMAL_MIN_LIMBS ? bigint_thread_pool() : nullptr);
+    group.run([&] { high.decimal_tree_(level - 1, count - half, chunks + half, powers); });
+    low.decimal_tree_(level - 1, half, chunks, powers);
+    group.wait();
+}
+
 
-    right.two_complement_();
-    two_complement_();
-    for (size_t i = 0; i < sz; i++) {
-        uint64_t l = i < data_.size() ? data_[i] : sign() ? MAX_DIGIT : 0ULL;
-        uint64_t r = i < right.data_.size() ? right.data_[i] : right.sign() ? MAX_DIGIT : 0ULL;
-        if (i == data_.size()) {
-            data_.push_back(0ULL);
+// номер младшей ненулевой цифры, n -- если таких нет
+static size_t lowest_nonzero_(const limb_t* digits, size_t n) {
+    size_t i = 0;
+    while (i < n && digits[i] == 0) {
+        i++;
+    }
+    return i;
+}
+
+
+// цифра i дополнительного кода -x: ниже младшей ненулевой цифры x нули, в ней -x[low], выше ~x[i]
+static limb_t twos_digit_(limb_t x, size_t i, size_t low) {
+    return i < low ? 0 : i == low ? static_cast<limb_t>(~x + 1) : static_cast<limb_t>(~x);
+}
+
+
+/*
+ * Операция над дополнительными кодами без их построения: до младших
+ * ненулевых цифр операндов код считается поцифрово, а выше цифры
+ * отрицательного числа -- это инвертированные цифры модуля, и остаток
+ * обрабатывается векторными ядрами limb_bitwise_n с масками. За концом right
+ * его цифры постоянны (0 или ~0), и операция вырождается в заполнение
+ * или копирование с маской
+ */
+big_integer& big_integer::apply_bitwise_(limb_bitwise_op op, const big_integer& right) {
+    if (this == &right) {
+        return apply_bitwise_(op, big_integer(right));
+    }
+    bool left_sign = sign(), right_sign = right.sign();
+    bool new_sign = limb_apply_bitwise(op, left_sign, right_sign);
+    limb_t left_mask = left_sign ? MAX_DIGIT : 0, right_mask = right_sign ? MAX_DIGIT : 0;
+
+    size_t left_size = data_.size(), right_size = right.data_.size();
+    size_t n = std::max(left_size, right_size);
+    data_.resize(n);
+    limb_t* digits = data_.make_unique();
+    const limb_t* right_digits = right.data_.cbegin();
+    size_t left_low = lowest_nonzero_(digits, left_size);
+    size_t right_low = lowest_nonzero_(right_digits, right_size);
+
+    size_t head = std::min(n, std::max(left_sign ? left_low + 1 : 0, right_sign ? right_low + 1 : 0));
+    for (size_t i = 0; i < head; i++) {
+        limb_t l = left_sign ? twos_digit_(digits[i], i, left_low) : digits[i];
+        limb_t r = i < right_size ? right_digits[i] : 0;
+        r = right_sign ? twos_digit_(r, i, right_low) : r;
+        digits[i] = limb_apply_bitwise(op, l, r);
+    }
+    size_t body = std::max(head, std::min(n, right_size));
+    if (body > head) {
+        limb_bitwise_n(op, digits + head, digits + head, right_digits + head, body - head, left_mask, right_mask);
+    }
+    if (body < n) {
+        if ((op == LIMB_BITWISE_AND && !right_sign) || (op == LIMB_BITWISE_OR && right_sign)) {
+            std::fill(digits + body, digits + n, right_mask);
+        } else {
+            limb_t mask = op == LIMB_BITWISE_XOR ? left_mask ^ right_mask : left_mask;
+            limb_bitwise_n(LIMB_BITWISE_AND, digits + body, digits + body, digits + body, n - body, mask, mask);
         }
-        data_[i] = f(l, r);
     }
-    set_sign_(new_sign);
-    two_complement_();
+
+    // отрицательный результат переводится из дополнительного кода обратно в модуль
+    if (new_sign) {
+        size_t low = lowest_nonzero_(digits, n);
+        if (low == n) {
+            // все n цифр нулевые -- это -2^(BASE_POWER2 * n)
+            data_.push_back(1);
+        } else {
+            digits[low] = static_cast<limb_t>(~digits[low] + 1);
+            limb_bitwise_n(LIMB_BITWISE_AND, digits + low + 1, digits + low + 1, digits + low + 1, n - low - 1,
+                           MAX_DIGIT, MAX_DIGIT);
+        }
+    }
+    sign_ = new_sign;
     keep_invariant_();
     return (*this);
 }
 
 
 void big_integer::keep_invariant_() {
-    while (data_.size() > 1 && data_.back() == 0) {
-        data_.pop_back();
+    keep_invariant_(data_.size());
+}
+
+
+/*
+ * len -- известная ядру граница длины результата: цифры с номерами >= len
+ * отбрасываются без проверки, ниже лидирующие нули ищутся за один проход,
+ * и размер меняется одним resize
+ */
+void big_integer::keep_invariant_(size_t len) {
+    const limb_t* digits = data_.cbegin();
+    while (len > 1 && digits[len - 1] == 0) {
+        len--;
+    }
+    if (len != data_.size()) {
+        data_.resize(len);
     }
     set_sign_(sign_);
 }
@@ -200,15 +571,15 @@ big_integer& big_integer::operator+=(const big_integer& right) {
         switch_sign_();
         return (*this);
     }
-    data_.resize(std::max(data_.size(), right.data_.size()) + 1);
-    uint64_t carry = false;
-    for (size_t i = 0; i < data_.size(); i++) {
-        uint64_t left_ = (i < data_.size() ? data_[i] : 0ULL);
-        uint64_t right_ = (i < right.data_.size() ? right.data_[i] : 0ULL);
-        data_[i] = left_ + right_ + carry;
-        carry = add_overflow_(left_, right_, carry);
-    }
-    keep_invariant_();
+    size_t n = std::max(data_.size(), right.data_.size());
+    data_.resize(n + 1);
+    // right может совпадать с (*this), поэтому его цифры берутся после resize;
+    // цифры (*this) выше его прежней длины -- нули, так что складывать можно по длине right
+    limb_t* digits = data_.make_unique();
+    size_t right_size = right.data_.size();
+    limb_t carry = limb_add_n(digits, digits, right.data_.cbegin(), right_size);
+    limb_add_1(digits + right_size, digits + right_size, n + 1 - right_size, carry);
+    keep_invariant_(n + 1);
     return (*this);
 }
 
@@ -223,21 +594,23 @@ big_integer& big_integer::operator-=(const big_integer& right) {
         switch_sign_();
         return (*this);
     }
-    bool new_sign = (*this) < right;
-    data_.resize(std::max(data_.size(), right.data_.size()));
-
-    uint64_t carry = false;
-    for (size_t i = 0; i < data_.size(); i++) {
-        uint64_t left_ = (i < data_.size() ? data_[i] : 0ULL);
-        uint64_t right_ = (i < right.data_.size() ? right.data_[i] : 0ULL);
-        if (sign() ^ new_sign) {
-            std::swap(left_, right_);
-        }
-        data_[i] = left_ - right_ - carry;
-        carry = sub_overflow_(left_, right_, carry);
+    bool swapped = compare_abs_(right) < 0;
+    bool new_sign = sign() ^ swapped;
+    size_t n = std::max(data_.size(), right.data_.size());
+    data_.resize(n);
+
+    limb_t* digits = data_.make_unique();
+    const limb_t* right_digits = right.data_.cbegin();
+    size_t right_size = right.data_.size();
+    if (swapped) {
+        // модуль right больше, и его длина равна n
+        limb_sub_n(digits, right_digits, digits, n);
+    } else {
+        limb_t borrow = limb_sub_n(digits, digits, right_digits, right_size);
+        limb_sub_1(digits + right_size, digits + right_size, n - right_size, borrow);
     }
     set_sign_(new_sign);
-    keep_invariant_();
+    keep_invariant_(n);
     return (*this);
 }
 
@@ -246,23 +619,10 @@ big_integer& big_integer::operator*=(const big_integer& right) {
     big_integer result;
     result.data_.resize(data_.size() + right.data_.size());
 
-    for (size_t i = 0; i < data_.size(); i++) {
-        uint64_t carry = 0;
-        for (size_t j = 0; j < right.data_.size() || carry > 0; j++) {
-            uint64_t left_ = data_[i];
-            uint64_t right_ = j < right.data_.size() ? right.data_[j] : 0;
-            uint64_t upper = mul_overflow_(left_, right_);
-            uint64_t lower = left_ * right_;
-            upper += add_overflow_(lower, carry);
-            lower += carry;
-            upper += add_overflow_(lower, result.data_[i + j]);
-            lower += result.data_[i + j];
-            carry = upper;
-            result.data_[i + j] = lower;
-        }
-    }
+    size_t left_size = data_.size(), right_size = right.data_.size();
+    limb_mul(result.data_.make_unique(), data_.cbegin(), left_size, right.data_.cbegin(), right_size);
     result.set_sign_(sign() ^ right.sign());
-    result.keep_invariant_();
+    result.keep_invariant_(left_size + right_size);
     return (*this) = result;
 }
 
@@ -270,7 +630,7 @@ big_integer& big_integer::operator*=(const big_integer& right) {
 big_integer& big_integer::operator/=(const big_integer& right) {
     assert(right != ZERO);
 
-    if (this->abs_() < right.abs_()) {
+    if (compare_abs_(right) < 0) {
         return (*this) = 0;
     }
 
@@ -281,32 +641,36 @@ big_integer& big_integer::operator/=(const big_integer& right) {
         return (*this);
     }
 
-    const uint64_t NORM_FACTOR = right.data_.back() == MAX_DIGIT ? 1 : MAX_DIGIT / (right.data_.back() + 1);
-    big_integer u = (*this) * NORM_FACTOR;
-    big_integer d = right * NORM_FACTOR;
-
-    u.data_.push_back(0);
-    u.set_sign_(false);
-    d.set_sign_(false);
+    // нормализация сдвигом: старший бит делителя становится единицей, и оценка
+    // цифры частного по двум старшим цифрам остатка ошибается не больше чем на 2
+    size_t n = data_.size() + 1, m = right.data_.size();
+    unsigned shift = static_cast<unsigned>(BASE_POWER2 - digit_length_(right.data_.back()));
+    storage_type u(n, 0), d(m, 0);
+    limb_t* u_digits = u.make_unique();
+    limb_t* d_digits = d.make_unique();
+    u_digits[n - 1] = limb_lshift(u_digits, data_.cbegin(), n - 1, shift);
+    limb_lshift(d_digits, right.data_.cbegin(), m, shift);
 
-    size_t n = u.data_.size(), m = d.data_.size();
     data_.resize(n - m);
-    set_sign_(new_sign);
-
-    big_integer dq;
+    limb_t* quotient = data_.make_unique();
+    const limb_t d_top = d_digits[m - 1];
     for (size_t k = n - m; k --> 0; ) {
-        uint64_t qt = soft_div(k + m < u.data_.size() ? u.data_[k + m] : 0,
-                               k + m - 1 < u.data_.size() ? u.data_[k + m - 1] : 0,
-                               d.data_[m - 1]);
-        dq = d * qt;
-        while (qt != 0 && u < dq << BASE_POWER2 * k) {
-            --qt;
-            dq -= d;
+        // u[k, k + m] -= qt * d; если вышло меньше нуля, qt была велика, и d прибавляется обратно
+        limb_t qt = soft_div(u_digits[k + m], u_digits[k + m - 1], d_top);
+        limb_t borrow = limb_submul_1<limb_t, limb_traits>(u_digits + k, d_digits, m, qt);
+        limb_t top = u_digits[k + m];
+        u_digits[k + m] = top - borrow;
+        if (top < borrow) {
+            do {
+                --qt;
+                top = u_digits[k + m];
+                u_digits[k + m] += limb_add_n(u_digits + k, u_digits + k, d_digits, m);
+            } while (u_digits[k + m] >= top);
         }
-        data_[k] = qt;
-        u -= dq << BASE_POWER2 * k;
+        quotient[k] = qt;
     }
-    keep_invariant_();
+    sign_ = new_sign;
+    keep_invariant_(n - m);
     return (*this);
 }
 
@@ -318,52 +682,52 @@ big_integer& big_integer::operator%=(const big_integer& right) {
 
 
 big_integer& big_integer::operator>>=(uint64_t right) {
-    if (sign()) {
+    bool neg = sign();
+    if (neg) {
         ++(*this);
     }
-    size_t right_bits = right / BASE_POWER2;
-    if (right_bits < data_.size()) {
-        std::reverse(data_.begin(), data_.end());
-        while (right_bits--) {
-            data_.pop_back();
-        }
-        std::reverse(data_.begin(), data_.end());
+    size_t limbs = right / BASE_POWER2, bits = right % BASE_POWER2, n = data_.size();
+    if (limbs < n) {
+        limb_t* digits = data_.make_unique();
+        limb_rshift(digits, digits + limbs, n - limbs, static_cast<unsigned>(bits));
+        keep_invariant_(n - limbs);
     } else {
-        data_ = uint_storage<uint64_t>(1, 0ULL);
+        data_ = storage_type(1, 0);
+        keep_invariant_(1);
     }
-    right %= BASE_POWER2;
-    (*this) /= 1ULL << right;
-    if (sign())
+    if (neg)
         --(*this);
     return (*this);
 }
 
 
 big_integer& big_integer::operator<<=(uint64_t right) {
-    if ((*this) == 0) {
+    size_t limbs = right / BASE_POWER2, bits = right % BASE_POWER2, n = data_.size();
+    if (n == 1 && data_.cbegin()[0] == 0) {
         return (*this);
     }
-    const size_t RIGHT_BITS = right / BASE_POWER2;
-    data_.resize(data_.size() + RIGHT_BITS);
-    std::move_backward(data_.begin(), data_.end() - RIGHT_BITS, data_.end());
-    std::fill(data_.begin(), data_.begin() + RIGHT_BITS, 0ULL);
-    right %= BASE_POWER2;
-    return (*this) *= 1ULL << right;
+    // результат занимает n + limbs цифр, либо на одну больше, если старшие биты выдвинулись
+    data_.resize(n + limbs + 1);
+    limb_t* digits = data_.make_unique();
+    digits[n + limbs] = limb_lshift(digits + limbs, digits, n, static_cast<unsigned>(bits));
+    std::fill(digits, digits + limbs, 0);
+    keep_invariant_(n + limbs + 1);
+    return (*this);
 }
 
 
 big_integer& big_integer::operator&=(const big_integer& right) {
-    return apply_bitwise_([](uint64_t a, uint64_t b) { return a & b; }, right);
+    return apply_bitwise_(LIMB_BITWISE_AND, right);
 }
 
 
 big_integer& big_integer::operator|=(const big_integer& right) {
-    return apply_bitwise_([](uint64_t a, uint64_t b) { return a | b; }, right);
+    return apply_bitwise_(LIMB_BITWISE_OR, right);
 }
 
 
 big_integer& big_integer::operator^=(const big_integer& right) {
-    return apply_bitwise_([](uint64_t a, uint64_t b) { return a ^ b; }, right);
+    return apply_bitwise_(LIMB_BITWISE_XOR, right);
 }
 
 
@@ -406,14 +770,8 @@ bool operator<(const big_integer& left, const big_integer& right) {
     if (!left.sign() && right.sign()) {
         return false;
     }
-    for (size_t i = std::max(left.data_.size(), right.data_.size()); i --> 0; ) {
-        uint64_t l = i < left.data_.size() ? left.data_[i] : 0ULL;
-        uint64_t r = i < right.data_.size() ? right.data_[i] : 0ULL;
-        if (l != r) {
-            return left.sign() ? l > r : l < r;
-        }
-    }
-    return false;
+    int abs_order = left.compare_abs_(right);
+    return left.sign() ? abs_order > 0 : abs_order < 0;
 }
 
 
@@ -499,28 +857,158 @@ big_integer operator~(const big_integer& val) {
 }
 
 
-std::string to_string(big_integer arg) {
-    std::string res;
-    bool neg = arg.sign();
-    do {
-        res.push_back(static_cast<char>(arg.div_short_(10) + '0'));
-    } while (arg != ZERO);
+static size_t chunk_length_(uint64_t chunk) {
+    size_t len = 1;
+    while (chunk >= 10) {
+        chunk /= 10;
+        len++;
+    }
+    return len;
+}
+
+
+// пишет блок ровно в len символов, дополняя нулями слева
+static char* write_chunk_(char* out, uint64_t chunk, size_t len) {
+    for (size_t i = len; i --> 0; ) {
+        out[i] = static_cast<char>('0' + chunk % 10);
+        chunk /= 10;
+    }
+    return out + len;
+}
+
+
+static size_t decimal_length_(bool neg, const std::vector<limb_t>& chunks) {
+    return neg + chunk_length_(chunks.back()) + (chunks.size() - 1) * DIGITS_COUNT;
+}
+
+
+static char* write_decimal_(char* out, bool neg, const std::vector<limb_t>& chunks) {
     if (neg) {
-        res.push_back('-');
+        *out++ = '-';
+    }
+    out = write_chunk_(out, chunks.back(), chunk_length_(chunks.back()));
+    // у каждого блока своё место в выводе, так что длинные числа пишутся кусками в пуле
+    size_t n = chunks.size() - 1;
+    const limb_t* data = chunks.data();
+    thread_pool::task_group group(n >= PARALLEL_RENDER_MIN_CHUNKS ? bigint_thread_pool() : nullptr);
+    for (size_t begin = 0; begin < n; begin += PARALLEL_RENDER_MIN_CHUNKS) {
+        size_t end = std::min(n, begin + PARALLEL_RENDER_MIN_CHUNKS);
+        group.run([=] {
+            for (size_t i = begin; i < end; i++) {
+                write_chunk_(out + (n - 1 - i) * DIGITS_COUNT, data[i], DIGITS_COUNT);
+            }
+        });
     }
-    std::reverse(res.begin(), res.end());
+    group.wait();
+    return out + n * DIGITS_COUNT;
+}
+
+
+std::string to_string(big_integer arg) {
+    std::vector<limb_t> chunks = arg.decimal_chunks_();
+    std::string res(decimal_length_(arg.sign(), chunks), '0');
+    write_decimal_(&res[0], arg.sign(), chunks);
     return res;
 }
 
 
+// возвращает конец записанного, либо nullptr, если буфер [first, last) мал
+char* to_chars(char* first, char* last, const big_integer& num) {
+    std::vector<limb_t> chunks = num.decimal_chunks_();
+    if (static_cast<size_t>(last - first) < decimal_length_(num.sign(), chunks)) {
+        return nullptr;
+    }
+    return write_decimal_(first, num.sign(), chunks);
+}
+
+
+// цифры читаются прямо из буфера потока и сразу сворачиваются в число блоками по DIGITS_COUNT
 std::istream& operator>>(std::istream& in, big_integer& num) {
-    std::string str;
-    in >> str;
-    num = big_integer(str);
+    std::istream::sentry sentry(in);
+    if (!sentry) {
+        return in;
+    }
+    using traits = std::istream::traits_type;
+    std::streambuf* sb = in.rdbuf();
+    traits::int_type c = sb->sgetc();
+    bool new_sign = traits::eq_int_type(c, traits::to_int_type('-'));
+    if (new_sign || traits::eq_int_type(c, traits::to_int_type('+'))) {
+        c = sb->snextc();
+    }
+
+    big_integer result;
+    uint64_t buf = 0ULL, power_10 = 1ULL;
+    size_t cur_cnt = 0;
+    bool any_digit = false;
+    while (!traits::eq_int_type(c, traits::eof())) {
+        // не std::isdigit: он зависит от локали, а на char >= 0x80 это UB
+        char ch = traits::to_char_type(c);
+        if (ch < '0' || ch > '9') {
+            break;
+        }
+        buf = buf * 10ULL + static_cast<uint64_t>(ch - '0');
+        power_10 *= 10ULL;
+        any_digit = true;
+        if (++cur_cnt == DIGITS_COUNT) {
+            result.mul_add_short_(power_10, buf);
+            buf = 0ULL;
+            power_10 = 1ULL;
+            cur_cnt = 0;
+        }
+        c = sb->snextc();
+    }
+    if (cur_cnt > 0) {
+        result.mul_add_short_(power_10, buf);
+    }
+
+    if (traits::eq_int_type(c, traits::eof())) {
+        in.setstate(std::ios_base::eofbit);
+    }
+    if (!any_digit) {
+        in.setstate(std::ios_base::failbit);
+        return in;
+    }
+    result.set_sign_(new_sign);
+    num = result;
     return in;
 }
 
 
+// блоки пишутся в поток через небольшой буфер, строка целиком не строится
 std::ostream& operator<<(std::ostream& out, const big_integer& num) {
-    return out << to_string(num);
+    std::ostream::sentry sentry(out);
+    if (!sentry) {
+        return out;
+    }
+    std::vector<limb_t> chunks = num.decimal_chunks_();
+    std::streamsize len = static_cast<std::streamsize>(decimal_length_(num.sign(), chunks));
+    std::streamsize pad = std::max<std::streamsize>(out.width() - len, 0);
+    bool left = (out.flags() & std::ios_base::adjustfield) == std::ios_base::left;
+    out.width(0);
+
+    std::streambuf* sb = out.rdbuf();
+    bool ok = true;
+    for (std::streamsize i = 0; !left && i < pad; i++) {
+        ok = ok && !std::ostream::traits_type::eq_int_type(sb->sputc(out.fill()), std::ostream::traits_type::eof());
+    }
+
+    char buf[DIGITS_COUNT + 1];
+    char* end = buf;
+    if (num.sign()) {
+        *end++ = '-';
+    }
+    end = write_chunk_(end, chunks.back(), chunk_length_(chunks.back()));
+    ok = ok && sb->sputn(buf, end - buf) == end - buf;
+    for (size_t i = chunks.size() - 1; ok && i --> 0; ) {
+        write_chunk_(buf, chunks[i], DIGITS_COUNT);
+        ok = sb->sputn(buf, DIGITS_COUNT) == static_cast<std::streamsize>(DIGITS_COUNT);
+    }
+
+    for (std::streamsize i = 0; left && i < pad; i++) {
+        ok = ok && !std::ostream::traits_type::eq_int_type(sb->sputc(out.fill()), std::ostream::traits_type::eof());
+    }
+    if (!ok) {
+        out.setstate(std::ios_base::badbit);
+    }
+    return out;
 }
\ No newline at end of file
@@ -1,11 +1,19 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "uint_storage.h"
+#include "limb_kernels.h"
+#include "limb_traits.h"
 #include <functional>
 
+// сколько цифр числа хранится без выделения памяти, по умолчанию 256 бит
+#ifndef BIGINT_INLINE_LIMBS
+#define BIGINT_INLINE_LIMBS (256 / 8 / sizeof(BIGINT_LIMB_TRAITS::limb_t))
+#endif
+
 /*
- * data_ содержит цифры числа в системе счисления 2^64,
+ * data_ содержит цифры числа в системе счисления 2^(8 * sizeof(limb_type)),
  * записанные начиная с младших цифр. Лидирующие нули
  * отсутствуют, кроме единственного, если число = 0
  *
@@ -13,16 +21,26 @@
  */
 
 class big_integer {
+ public:
+    using limb_traits = BIGINT_LIMB_TRAITS;
+    using limb_type = limb_traits::limb_t;
+    using storage_type = uint_storage<limb_type, BIGINT_INLINE_LIMBS>;
+
  private:
-    uint_storage<uint64_t> data_;
+    storage_type data_;
     bool sign_;
     void set_sign_(bool);
     void switch_sign_();
-    big_integer abs_() const;
-    uint64_t div_short_(uint64_t);
-    void two_complement_();
-    big_integer& apply_bitwise_(const std::function<uint64_t(uint64_t, uint64_t)>&, big_integer);
+    int compare_abs_(const big_integer&) const;
+    static storage_type digits_of_(uint64_t);
+    limb_type div_short_(limb_type);
+    void mul_add_short_(limb_type, limb_type);
+    struct decimal_powers_;
+    std::vector<limb_type> decimal_chunks_() const;
+    void decimal_tree_(size_t, size_t, limb_type*, const decimal_powers_&) const;
+    big_integer& apply_bitwise_(limb_bitwise_op, const big_integer&);
     void keep_invariant_();
+    void keep_invariant_(size_t);
  public:
     big_integer();
     big_integer(const int&);
@@ -36,6 +54,40 @@ class big_integer {
 
     bool sign() const;
 
+    /*
+     * Битовые запросы. Отрицательные числа рассматриваются
+     * в бесконечном дополнительном коде, как и в apply_bitwise_
+     */
+    size_t bit_length() const;
+    size_t popcount() const;
+    size_t ctz() const;
+    bool test_bit(size_t) const;
+    big_integer& set_bit(size_t);
+    big_integer& clear_bit(size_t);
+
+    size_t hash() const;
+
+    /*
+     * Двоичный импорт/экспорт модуля числа по аналогии с mpz_import/mpz_export:
+     * order -- 1 если старшее слово первое, -1 если младшее,
+     * endian -- 1 big-endian, -1 little-endian, 0 порядок байт платформы.
+     * Знак передаётся отдельно. Слова по 8 байт в порядке платформы
+     * и order == -1 копируются одним memcpy
+     */
+    size_t export_size(size_t size) const;
+    size_t export_limbs(void*, int order, size_t size, int endian) const;
+    big_integer& import_limbs(const void*, size_t count, int order, size_t size, int endian, bool negative = false);
+
+    // цифры модуля без копирования, младшие первыми; действительны до изменения числа
+    const limb_type* limbs() const;
+    size_t limb_count() const;
+
+    /*
+     * Число поверх чужого буфера цифр без копирования (младшие первыми).
+     * owner держит буфер живым; при первом изменении цифры копируются
+     */
+    static big_integer view(const limb_type*, size_t count, bool negative, std::shared_ptr<const void> owner);
+
     big_integer& operator=(const big_integer&);
 
     big_integer& operator+=(const big_integer&);
@@ -82,4 +134,14 @@ class big_integer {
     friend std::istream& operator>>(std::istream&, big_integer&);
 
     friend std::string to_string(big_integer);
-};
\ No newline at end of file
+    friend char* to_chars(char*, char*, const big_integer&);
+};
+
+namespace std {
+    template <>
+    struct hash<big_integer> {
+        size_t operator()(const big_integer& val) const {
+            return val.hash();
+        }
+    };
+}
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "big_integer.h"
+#include "limb_dispatch.h"
+#include "limb_resource.h"
+#include "thread_pool.h"
+
+/*
+ * Замеры основных операций big_integer на числах разной длины.
+ * Собирается для каждой политики цифры и с атомарным счётчиком ссылок
+ * (см. CMakeLists.txt), чтобы варианты можно было сравнить между собой
+ */
+
+#define BIGINT_STRINGIFY_(x) #x
+#define BIGINT_STRINGIFY(x) BIGINT_STRINGIFY_(x)
+
+namespace {
+    big_integer random_big_integer(size_t bits, std::mt19937_64& rng) {
+        std::vector<uint64_t> words((bits + 63) / 64);
+        for (uint64_t& w : words) {
+            w = rng();
+        }
+        return big_integer().import_limbs(words.data(), words.size(), -1, sizeof(uint64_t), 0);
+    }
+
+    // среднее время одного вызова f в микросекундах
+    template <typename F>
+    double measure(F f) {
+        using clock = std::chrono::steady_clock;
+        size_t reps = 0;
+        clock::time_point start = clock::now(), now;
+        do {
+            f();
+            ++reps;
+            now = clock::now();
+        } while (now - start < std::chrono::milliseconds(200));
+        return std::chrono::duration<double, std::micro>(now - start).count() / reps;
+    }
+
+    volatile size_t sink;
+}
+
+int main() {
+    std::printf("limb traits: %s (%zu-bit limbs)\n", BIGINT_STRINGIFY(BIGINT_LIMB_TRAITS),
+                8 * sizeof(big_integer::limb_type));
+    std::printf("inline limbs: %zu, sizeof(big_integer) = %zu\n", static_cast<size_t>(BIGINT_INLINE_LIMBS),
+                sizeof(big_integer));
+    // другие наборы ядер выбираются переменной BIGINT_KERNELS, см. limb_dispatch.h
+    std::printf("mul kernels: %s, bitwise kernels: %s, add/sub kernels: %s\n", limb_dispatch().mul.name,
+                limb_dispatch().bitwise.name, limb_dispatch().addsub.name);
+#ifdef BIGINT_ATOMIC_REFCOUNT
+    std::printf("refcount: atomic\n");
+#else
+    std::printf("refcount: plain\n");
+#endif
+    std::printf("%8s %12s %12s %12s %12s %12s %12s\n", "bits", "add, us", "mul, us", "div, us", "to_string, us",
+                "copy, ns", "and, us");
+
+    std::mt19937_64 rng(42);
+    for (size_t bits : {128, 256, 512, 1024, 4096, 16384}) {
+        big_integer a = random_big_integer(bits, rng);
+        big_integer b = random_big_integer(bits, rng);
+        big_integer c = random_big_integer(bits / 2, rng) + 1;
+        big_integer ab = a * b;
+
+        double add = measure([&] { sink = (a + b).limb_count(); });
+        double mul = measure([&] { sink = (a * b).limb_count(); });
+        double div = measure([&] { sink = (ab / c).limb_count(); });
+        double str = measure([&] { sink = to_string(a).size(); });
+        // копия разделяет буфер с a, так что замеряется только работа со счётчиком ссылок
+        double copy = measure([&] {
+            for (size_t i = 0; i < 1000; i++) {
+                big_integer t(a);
+                sink = t.limb_count();
+            }
+        });
+        // с отрицательным операндом, чтобы учитывался перевод в дополнительный код
+        big_integer neg_b = -b;
+        double bit_and = measure([&] { sink = (a & neg_b).limb_count(); });
+        std::printf("%8zu %12.3f %12.3f %12.3f %12.3f %12.3f %12.3f\n", bits, add, mul, div, str, copy, bit_and);
+    }
+
+    // побитовые операции над числами-битовыми масками в несколько мегабит
+    {
+        size_t bits = size_t(1) << 22;
+        big_integer a = random_big_integer(bits, rng);
+        big_integer b = -random_big_integer(bits, rng);
+        double bit_and = measure([&] { sink = (a & b).limb_count(); });
+        double bit_or = measure([&] { sink = (a | b).limb_count(); });
+        double bit_xor = measure([&] { sink = (a ^ b).limb_count(); });
+        std::printf("%zu bits: and %.1f us, or %.1f us, xor %.1f us\n", bits, bit_and, bit_or, bit_xor);
+    }
+
+    // сложение и вычитание на месте, без выделения памяти под результат
+    {
+        size_t bits = size_t(1) << 22;
+        big_integer a = random_big_integer(bits, rng);
+        big_integer b = random_big_integer(bits - 64, rng);
+        double add = measure([&] { sink = (a += b).limb_count(); });
+        double sub = measure([&] { sink = (a -= b).limb_count(); });
+        std::printf("%zu bits: += %.1f us, -= %.1f us\n", bits, add, sub);
+    }
+
+    // все наборы ядер, доступные на этой машине и в этой сборке, на одних и тех же данных
+    {
+        std::vector<uint64_t> a(1024), b(1024), r(2048);
+        for (size_t i = 0; i < a.size(); i++) {
+            a[i] = rng();
+            b[i] = rng();
+        }
+        for (const char* name : {"portable", "adc", "avx512", "bigasm"}) {
+            if (const addsub_kernels* k = find_addsub_kernels(name)) {
+                double add64 = measure([&] { sink = k->add_n(r.data(), a.data(), b.data(), 64); });
+                double add1024 = measure([&] { sink = k->add_n(r.data(), a.data(), b.data(), 1024); });
+                std::printf("add_n %-8s 64 limbs %.3f us, 1024 limbs %.3f us\n", name, add64, add1024);
+            }
+        }
+        for (const char* name : {"portable", "adx", "ifma", "bigasm"}) {
+            if (const mul_kernels* k = find_mul_kernels(name)) {
+                double mul16 = measure([&] { k->mul_basecase(r.data(), a.data(), 16, b.data(), 16); });
+                double mul256 = measure([&] { k->mul_basecase(r.data(), a.data(), 256, b.data(), 256); });
+                std::printf("mul_basecase %-8s 16x16 limbs %.3f us, 256x256 limbs %.3f us\n", name, mul16, mul256);
+            }
+        }
+    }
+
+    // масштабирование умножения и перевода в строку миллионобитных чисел по числу потоков, см. set_bigint_threads
+    {
+        size_t bits = size_t(1) << 22;
+        big_integer a = random_big_integer(bits, rng);
+        big_integer b = random_big_integer(bits, rng);
+        size_t max_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        double single_mul = 0, single_str = 0;
+        for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+            set_bigint_threads(threads);
+            double mul = measure([&] { sink = (a * b).limb_count(); });
+            double str = measure([&] { sink = to_string(a).size(); });
+            if (threads == 1) {
+                single_mul = mul;
+                single_str = str;
+            }
+            std::printf("%zu bits, %zu threads: mul %.1f us (x%.2f), to_string %.1f us (x%.2f)\n", bits, threads,
+                        mul, single_mul / mul, str, single_str / str);
+        }
+        set_bigint_threads(1);
+    }
+
+    limb_pool_stats stats = get_limb_pool_stats();
+    std::printf("limb pool: %zu hits, %zu misses, %zu blocks (%zu bytes) cached\n", stats.hits, stats.misses,
+                stats.cached, stats.cached_bytes);
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "big_integer_mmap.h"
+
+static const char MAGIC[8] = {'B', 'I', 'G', 'I', 'N', 'T', '\0', '\1'};
+static const uint64_t BYTE_ORDER_MARK = 0x0102030405060708ULL;
+
+// код ошибки передаётся явно: fclose/close после неудачного вызова могут затереть errno
+static std::system_error errno_error_(int error, const std::string& what) {
+    return std::system_error(error != 0 ? error : EIO, std::generic_category(), what);
+}
+
+static big_integer_file_header make_header_(uint64_t limb_count, bool negative) {
+    big_integer_file_header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.byte_order = BYTE_ORDER_MARK;
+    header.limb_count = limb_count;
+    header.limb_size = sizeof(big_integer::limb_type);
+    header.sign = negative;
+    return header;
+}
+
+
+big_integer_writer::big_integer_writer(const std::string& path)
+        : file_(std::fopen(path.c_str(), "wb")), limb_count_(0) {
+    if (file_ == nullptr) {
+        throw errno_error_(errno, "cannot open " + path);
+    }
+    big_integer_file_header header = make_header_(0, false);
+    if (std::fwrite(&header, sizeof(header), 1, file_) != 1) {
+        int error = errno;
+        std::fclose(file_);
+        throw errno_error_(error, "cannot write " + path);
+    }
+}
+
+
+big_integer_writer::~big_integer_writer() {
+    if (file_ != nullptr) {
+        std::fclose(file_);
+    }
+}
+
+
+void big_integer_writer::check_open_() const {
+    if (file_ == nullptr) {
+        throw std::logic_error("big_integer_writer: already closed");
+    }
+}
+
+
+void big_integer_writer::write(const big_integer::limb_type* limbs, size_t count) {
+    check_open_();
+    if (std::fwrite(limbs, sizeof(big_integer::limb_type), count, file_) != count) {
+        throw errno_error_(errno, "big_integer_writer: write failed");
+    }
+    limb_count_ += count;
+}
+
+
+void big_integer_writer::write(const big_integer& num) {
+    write(num.limbs(), num.limb_count());
+}
+
+
+// заголовок дописывается в конце, когда известно число цифр
+void big_integer_writer::close(bool negative) {
+    check_open_();
+    big_integer_file_header header = make_header_(limb_count_, negative);
+    bool ok = std::fseek(file_, 0, SEEK_SET) == 0
+              && std::fwrite(&header, sizeof(header), 1, file_) == 1;
+    int error = ok ? 0 : errno;
+    if (std::fclose(file_) != 0 && ok) {
+        ok = false;
+        error = errno;
+    }
+    file_ = nullptr;
+    if (!ok) {
+        throw errno_error_(error, "big_integer_writer: close failed");
+    }
+}
+
+
+void save_big_integer(const std::string& path, const big_integer& num) {
+    big_integer_writer writer(path);
+    writer.write(num);
+    writer.close(num.sign());
+}
+
+
+namespace {
+    struct mapping_ {
+        void* addr = MAP_FAILED;
+        size_t length = 0;
+
+        ~mapping_() {
+            if (addr != MAP_FAILED) {
+                munmap(addr, length);
+            }
+        }
+    };
+}
+
+big_integer map_big_integer(const std::string& path) {
+    // владелец создаётся до mmap, чтобы отображение снималось при любом исключении после него
+    std::shared_ptr<mapping_> owner = std::make_shared<mapping_>();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw errno_error_(errno, "cannot open " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int error = errno;
+        close(fd);
+        throw errno_error_(error, "cannot stat " + path);
+    }
+    size_t length = static_cast<size_t>(st.st_size);
+    if (length < sizeof(big_integer_file_header)) {
+        close(fd);
+        throw std::runtime_error(path + ": truncated big_integer file");
+    }
+    void* addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    int error = errno;
+    close(fd);
+    if (addr == MAP_FAILED) {
+        throw errno_error_(error, "cannot mmap " + path);
+    }
+    owner->addr = addr;
+    owner->length = length;
+
+    const auto* header = static_cast<const big_integer_file_header*>(addr);
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->byte_order != BYTE_ORDER_MARK
+        || header->limb_size != sizeof(big_integer::limb_type)) {
+        throw std::runtime_error(path + ": not a big_integer file of this platform");
+    }
+    if (header->limb_count > (length - sizeof(*header)) / sizeof(big_integer::limb_type)) {
+        throw std::runtime_error(path + ": truncated big_integer file");
+    }
+    const auto* limbs = reinterpret_cast<const big_integer::limb_type*>(header + 1);
+    return big_integer::view(limbs, header->limb_count, header->sign != 0, std::move(owner));
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include "big_integer.h"
+
+/*
+ * Двоичный формат файла: заголовок big_integer_file_header,
+ * за ним limb_count цифр по limb_size байт в порядке байт платформы,
+ * начиная с младших. Такой файл отображается в память и
+ * используется как big_integer без копирования
+ */
+
+struct big_integer_file_header {
+    char magic[8];
+    uint64_t byte_order;  // BYTE_ORDER_MARK в порядке байт записавшей платформы
+    uint64_t limb_count;
+    uint32_t limb_size;
+    uint32_t sign;
+};
+
+/*
+ * Записывает цифры потоком, не требуя всего числа в памяти. Заголовок с
+ * числом цифр дописывает только close(): если разрушить writer без close(),
+ * в файле останется limb_count = 0. write() и close() после close()
+ * бросают std::logic_error
+ */
+struct big_integer_writer {
+    explicit big_integer_writer(const std::string& path);
+    big_integer_writer(const big_integer_writer&) = delete;
+    big_integer_writer& operator=(const big_integer_writer&) = delete;
+    ~big_integer_writer();
+
+    void write(const big_integer::limb_type* limbs, size_t count);
+    void write(const big_integer&);
+    void close(bool negative = false);
+
+ private:
+    void check_open_() const;
+
+    FILE* file_;
+    uint64_t limb_count_;
+};
+
+void save_big_integer(const std::string& path, const big_integer&);
+
+// результат только для чтения разделяет отображение; оно снимается вместе с последней копией
+big_integer map_big_integer(const std::string& path);
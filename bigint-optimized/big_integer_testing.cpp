@@ -1,13 +1,33 @@
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cerrno>
 #include <cstdlib>
+#include <iomanip>
 #include <random>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <utility>
 #include <gtest/gtest.h>
 
 #include "big_integer.h"
 #include "big_integer_gmp.h"
+#include "big_integer_mmap.h"
+#include "fixed_integer.h"
+#include "limb_dispatch.h"
+#include "limb_kernels.h"
+#include "limb_mul.h"
+#include "limb_ops.h"
+#include "limb_resource.h"
+#include "thread_pool.h"
+
+#ifdef BIGINT_HAVE_BIGASM
+#include "bigasm.h"
+#endif
 
 TEST(correctness, two_plus_two) {
   EXPECT_EQ(big_integer(4), big_integer(2) + big_integer(2));
@@ -744,6 +764,19 @@ TEST(correctness_random, mul) {
   }
 }
 
+// средние длины, на которых умножение может идти через IFMA
+TEST(correctness_random, mul_mid_size) {
+  std::default_random_engine rng(43);
+  for (size_t itn = 0; itn != 20; ++itn) {
+    big_integer_gmp a, b;
+    a.random(1500 + rng() % 20000, rng);
+    b.random(1500 + rng() % 20000, rng);
+    big_integer_gmp c = a * b;
+    big_integer R = big_integer(to_string(a)) * big_integer(to_string(b));
+    EXPECT_EQ(to_string(c), to_string(R));
+  }
+}
+
 TEST(correctness_random, div) {
   std::default_random_engine rng(322);
   for (size_t itn = 0; itn != number_of_iterations; ++itn) {
@@ -796,6 +829,55 @@ TEST(correctness_random, bitwise) {
   }
 }
 
+// длинные числа разной длины с нулевыми младшими цифрами: все ветви перевода в дополнительный код
+TEST(correctness_random, bitwise_long_operands) {
+  std::mt19937_64 rng(44);
+  for (size_t itn = 0; itn != 40; ++itn) {
+    big_integer x[2];
+    for (big_integer& v : x) {
+      std::vector<uint64_t> words(rng() % 300 + 1);
+      for (uint64_t& w : words) {
+        w = rng() % 3 == 0 ? 0 : rng();
+      }
+      v = big_integer().import_limbs(words.data(), words.size(), -1, sizeof(uint64_t), 0, rng() % 2 == 0);
+      v <<= rng() % 1000;
+    }
+    big_integer_gmp a(to_string(x[0])), b(to_string(x[1]));
+    EXPECT_EQ(to_string(a & b), to_string(x[0] & x[1]));
+    EXPECT_EQ(to_string(a | b), to_string(x[0] | x[1]));
+    EXPECT_EQ(to_string(a ^ b), to_string(x[0] ^ x[1]));
+  }
+  // результат -2^64: все цифры дополнительного кода нулевые
+  big_integer m = -((big_integer(1) << 64) - 1);
+  EXPECT_EQ(-(big_integer(1) << 64), m & -2);
+}
+
+TEST(correctness_random, bitwise_kernels) {
+  std::mt19937_64 rng(45);
+  const bitwise_kernels* scalar = find_bitwise_kernels("scalar");
+  ASSERT_NE(nullptr, scalar);
+  for (const char* name : {"scalar", "avx2", "avx512"}) {
+    const bitwise_kernels* k = find_bitwise_kernels(name);
+    if (k == nullptr) {
+      continue;
+    }
+    for (int iter = 0; iter < 100; iter++) {
+      size_t n = rng() % 40;
+      std::vector<uint64_t> a(n), b(n), r(n), expected(n);
+      for (size_t i = 0; i < n; i++) {
+        a[i] = rng();
+        b[i] = rng();
+      }
+      uint64_t ma = rng() % 2 ? ~0ULL : 0, mb = rng() % 2 ? ~0ULL : 0;
+      for (int op = LIMB_BITWISE_AND; op <= LIMB_BITWISE_XOR; op++) {
+        k->ops[op](r.data(), a.data(), b.data(), n, ma, mb);
+        scalar->ops[op](expected.data(), a.data(), b.data(), n, ma, mb);
+        EXPECT_EQ(expected, r) << name;
+      }
+    }
+  }
+}
+
 TEST(correctness_random, bit_shifts) {
   std::default_random_engine rng(42);
   for (size_t itn = 0; itn != number_of_iterations; ++itn) {
@@ -835,3 +917,940 @@ TEST(correctness_twos_complement, all_ones) {
 
   EXPECT_EQ(to_string(gmp_ans), to_string(your_ans));
 }
+
+TEST(correctness, bit_queries) {
+  EXPECT_EQ(0u, big_integer(0).bit_length());
+  EXPECT_EQ(1u, big_integer(1).bit_length());
+  EXPECT_EQ(65u, (big_integer(1) << 64).bit_length());
+  EXPECT_EQ(0u, big_integer(-1).bit_length());
+  EXPECT_EQ(64u, (-(big_integer(1) << 64)).bit_length());
+  EXPECT_EQ(65u, (-(big_integer(1) << 64) - 1).bit_length());
+
+  EXPECT_EQ(0u, big_integer(0).popcount());
+  EXPECT_EQ(64u, big_integer(std::numeric_limits<uint64_t>::max()).popcount());
+  EXPECT_EQ(0u, big_integer(-1).popcount());
+  EXPECT_EQ(1u, big_integer(-2).popcount());
+  EXPECT_EQ(64u, (-(big_integer(1) << 64)).popcount());
+
+  EXPECT_EQ(0u, big_integer(0).ctz());
+  EXPECT_EQ(70u, (big_integer(3) << 70).ctz());
+  EXPECT_EQ(70u, (big_integer(-3) << 70).ctz());
+
+  EXPECT_EQ(-1, big_integer(-3) >> 5);
+}
+
+TEST(correctness, set_clear_bit) {
+  big_integer a;
+  a.set_bit(130);
+  EXPECT_EQ(big_integer(1) << 130, a);
+  a.clear_bit(130);
+  EXPECT_EQ(0, a);
+
+  big_integer b = -1;
+  b.clear_bit(0);
+  EXPECT_EQ(-2, b);
+  b.clear_bit(100);
+  EXPECT_EQ(-2 - (big_integer(1) << 100), b);
+  b.set_bit(100);
+  b.set_bit(0);
+  EXPECT_EQ(-1, b);
+}
+
+TEST(correctness_random, bit_queries) {
+  std::default_random_engine rng(26);
+  for (size_t itn = 0; itn != number_of_iterations; ++itn) {
+    big_integer_gmp a;
+    a.random(max_size, rng);
+    big_integer R = big_integer(to_string(a));
+
+    for (size_t pos = 0; pos < max_size + 70; pos += 7) {
+      EXPECT_EQ(((R >> pos) & 1) != 0, R.test_bit(pos));
+    }
+    size_t len = R.bit_length();
+    EXPECT_EQ(R.sign() ? -1 : 0, R >> len);
+    if (len > 0) {
+      EXPECT_NE(R.sign() ? -1 : 0, R >> (len - 1));
+    }
+    size_t cnt = 0;
+    for (size_t pos = 0; pos < len; pos++) {
+      cnt += R.test_bit(pos) != R.sign();
+    }
+    EXPECT_EQ(cnt, R.popcount());
+  }
+}
+
+TEST(correctness, hash) {
+  std::hash<big_integer> h;
+  big_integer a("123456789012345678901234567890123456789");
+  big_integer b = a;
+  EXPECT_EQ(h(a), h(b));
+  EXPECT_EQ(h(a), h(big_integer(to_string(a))));
+  EXPECT_EQ(h(big_integer(0)), h(-big_integer(0)));
+  EXPECT_NE(h(a), h(-a));
+
+  size_t before = h(a);
+  b += 1;
+  EXPECT_NE(before, h(b));
+  b -= 1;
+  EXPECT_EQ(before, h(b));
+  EXPECT_EQ(before, h(a));
+}
+
+TEST(correctness, hash_unordered_map) {
+  std::unordered_map<big_integer, int> map;
+  big_integer key = big_integer(1) << 200;
+  for (int i = 0; i < 100; i++) {
+    map[key + i] = i;
+  }
+  EXPECT_EQ(100u, map.size());
+  EXPECT_EQ(42, map[(big_integer(1) << 200) + 42]);
+}
+
+TEST(correctness, export_import_limbs) {
+  big_integer a("-340282366920938463463374607431768211457"); // -(2^128 + 1)
+  EXPECT_EQ(128 / (8 * sizeof(big_integer::limb_type)) + 1, a.limb_count());
+  EXPECT_EQ(1u, a.limbs()[0]);
+  EXPECT_EQ(1u, a.limbs()[a.limb_count() - 1]);
+
+  uint64_t words[3];
+  EXPECT_EQ(3u, a.export_limbs(words, -1, sizeof(uint64_t), 0));
+  EXPECT_EQ(1u, words[0]);
+  EXPECT_EQ(0u, words[1]);
+  EXPECT_EQ(1u, words[2]);
+  EXPECT_EQ(a, big_integer().import_limbs(words, 3, -1, sizeof(uint64_t), 0, true));
+
+  unsigned char bytes[17];
+  EXPECT_EQ(17u, a.export_limbs(bytes, 1, 1, 0));
+  EXPECT_EQ(1, bytes[0]);
+  EXPECT_EQ(1, bytes[16]);
+  EXPECT_EQ(-a, big_integer().import_limbs(bytes, 17, 1, 1, 0));
+
+  EXPECT_EQ(0u, big_integer(0).export_size(4));
+  EXPECT_EQ(0, big_integer(5).import_limbs(bytes, 0, 1, 1, 0, true));
+}
+
+TEST(correctness_random, export_import_limbs) {
+  std::default_random_engine rng(28);
+  for (size_t itn = 0; itn != number_of_iterations; ++itn) {
+    big_integer_gmp a;
+    a.random(max_size, rng);
+    big_integer R = big_integer(to_string(a));
+
+    for (size_t size : {1, 3, 4, 8, 16}) {
+      for (int order : {-1, 1}) {
+        for (int endian : {-1, 0, 1}) {
+          std::vector<unsigned char> buf(R.export_size(size) * size);
+          size_t count = R.export_limbs(buf.data(), order, size, endian);
+          EXPECT_EQ(R, big_integer().import_limbs(buf.data(), count, order, size, endian, R.sign()));
+        }
+      }
+    }
+  }
+}
+
+TEST(correctness, mmap_round_trip) {
+  std::string path = "big_integer_mmap_test.bin";
+  big_integer a = -(big_integer(3) << 1000) + 17;
+  save_big_integer(path, a);
+
+  big_integer b = map_big_integer(path);
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(std::hash<big_integer>()(a), std::hash<big_integer>()(b));
+
+  big_integer c = b;
+  c += 1;
+  EXPECT_EQ(a + 1, c);
+  EXPECT_EQ(a, b);
+
+  b *= 2;
+  EXPECT_EQ(a * 2, b);
+  std::remove(path.c_str());
+}
+
+TEST(correctness, mmap_streaming_writer) {
+  std::string path = "big_integer_mmap_stream.bin";
+  {
+    big_integer_writer writer(path);
+    big_integer::limb_type chunk[4] = {1, 2, 3, 4};
+    writer.write(chunk, 4);
+    writer.write(chunk, 2);
+    writer.close();
+  }
+  big_integer expected;
+  for (int d : {2, 1, 4, 3, 2, 1}) {
+    expected = (expected << 8 * sizeof(big_integer::limb_type)) + d;
+  }
+  EXPECT_EQ(expected, map_big_integer(path));
+
+  {
+    big_integer_writer writer(path);
+    big_integer::limb_type zeros[3] = {0, 0, 0};
+    writer.write(zeros, 3);
+    writer.close(true);
+    EXPECT_THROW(writer.write(zeros, 1), std::logic_error);
+    EXPECT_THROW(writer.close(), std::logic_error);
+  }
+  big_integer zero = map_big_integer(path);
+  EXPECT_EQ(0, zero);
+  EXPECT_FALSE(zero.sign());
+  std::remove(path.c_str());
+}
+
+TEST(correctness, mmap_errors) {
+  try {
+    map_big_integer("no-such-dir/no-such-file.bin");
+    FAIL() << "map_big_integer must throw";
+  } catch (const std::system_error& e) {
+    EXPECT_EQ(ENOENT, e.code().value());
+  }
+  EXPECT_THROW(big_integer_writer("no-such-dir/out.bin"), std::system_error);
+}
+
+TEST(correctness, stream_input) {
+  std::istringstream in("  123456789012345678901234567890 -42 +7 0005\n-0 x");
+  big_integer a, b, c, d, e, f;
+  in >> a >> b >> c >> d >> e;
+  EXPECT_EQ(big_integer("123456789012345678901234567890"), a);
+  EXPECT_EQ(-42, b);
+  EXPECT_EQ(7, c);
+  EXPECT_EQ(5, d);
+  EXPECT_EQ(0, e);
+  EXPECT_FALSE(e.sign());
+  EXPECT_TRUE(static_cast<bool>(in));
+
+  f = 13;
+  in >> f;
+  EXPECT_TRUE(in.fail());
+  EXPECT_EQ(13, f);
+
+  // байты >= 0x80 (UTF-8) -- не цифры и останавливают чтение
+  std::istringstream utf8("42\xd9\xa3 \xff" "7");
+  utf8 >> a;
+  EXPECT_EQ(42, a);
+  EXPECT_EQ(0xd9, utf8.get());
+  utf8.ignore(2);
+  utf8 >> b;
+  EXPECT_TRUE(utf8.fail());
+}
+
+TEST(correctness_random, stream_input) {
+  std::default_random_engine rng(30);
+  for (size_t itn = 0; itn != number_of_iterations; ++itn) {
+    big_integer_gmp a;
+    a.random(max_size * 4, rng);
+    std::istringstream in(to_string(a));
+    big_integer R;
+    in >> R;
+    EXPECT_TRUE(in.eof());
+    EXPECT_EQ(to_string(a), to_string(R));
+  }
+}
+
+TEST(correctness, stream_output) {
+  std::ostringstream out;
+  big_integer a("-12345678901234567890000000000000000000001");
+  out << a << ' ' << big_integer(0) << ' ' << std::setw(6) << big_integer(42)
+      << ' ' << std::left << std::setw(4) << big_integer(-7) << '|';
+  EXPECT_EQ("-12345678901234567890000000000000000000001 0     42 -7  |", out.str());
+}
+
+TEST(correctness, to_chars) {
+  big_integer a("-10000000000000000000");
+  char buf[32];
+  char* end = to_chars(buf, buf + sizeof(buf), a);
+  ASSERT_NE(nullptr, end);
+  EXPECT_EQ("-10000000000000000000", std::string(buf, end));
+  EXPECT_EQ(nullptr, to_chars(buf, buf + 20, a));
+  end = to_chars(buf, buf + 21, a);
+  EXPECT_EQ(buf + 21, end);
+}
+
+TEST(correctness_random, stream_output) {
+  std::default_random_engine rng(31);
+  for (size_t itn = 0; itn != number_of_iterations; ++itn) {
+    big_integer_gmp a;
+    a.random(max_size * 4, rng);
+    std::ostringstream out;
+    out << big_integer(to_string(a));
+    EXPECT_EQ(to_string(a), out.str());
+  }
+}
+
+namespace {
+template <size_t Bits>
+big_integer wrap_to_bits(const big_integer& val) {
+  big_integer mod = big_integer(1) << Bits;
+  big_integer low = val & (mod - 1);
+  return low.test_bit(Bits - 1) ? low - mod : low;
+}
+
+template <size_t Bits>
+void check_fixed_integer_randomized(unsigned seed) {
+  std::default_random_engine rng(seed);
+  for (size_t itn = 0; itn != number_of_iterations * 10; ++itn) {
+    big_integer_gmp ga, gb;
+    ga.random(Bits - 1, rng);
+    gb.random(rng() % Bits, rng);
+    big_integer a(to_string(ga)), b(to_string(gb));
+    fixed_integer<Bits> fa(a), fb(b);
+    int shift = rng() % (Bits + 10);
+
+    EXPECT_EQ(a, static_cast<big_integer>(fa));
+    EXPECT_EQ(wrap_to_bits<Bits>(a + b), static_cast<big_integer>(fa + fb));
+    EXPECT_EQ(wrap_to_bits<Bits>(a - b), static_cast<big_integer>(fa - fb));
+    EXPECT_EQ(wrap_to_bits<Bits>(a * b), static_cast<big_integer>(fa * fb));
+    EXPECT_EQ(wrap_to_bits<Bits>(a & b), static_cast<big_integer>(fa & fb));
+    EXPECT_EQ(wrap_to_bits<Bits>(a | b), static_cast<big_integer>(fa | fb));
+    EXPECT_EQ(wrap_to_bits<Bits>(a ^ b), static_cast<big_integer>(fa ^ fb));
+    EXPECT_EQ(wrap_to_bits<Bits>(a << shift), static_cast<big_integer>(fa << shift));
+    EXPECT_EQ(a >> shift, static_cast<big_integer>(fa >> shift));
+    EXPECT_EQ(a < b, fa < fb);
+    if (b != 0) {
+      EXPECT_EQ(a / b, static_cast<big_integer>(fa / fb));
+      EXPECT_EQ(a % b, static_cast<big_integer>(fa % fb));
+    }
+  }
+}
+}
+
+TEST(correctness, bitwise_minus_one) {
+  big_integer a = (big_integer(1) << 200) + 12345;
+  EXPECT_EQ(a, a & -1);
+  EXPECT_EQ(-1, a | -1);
+  EXPECT_EQ(~a, a ^ -1);
+  EXPECT_EQ(-a, -a & -1);
+}
+
+TEST(correctness, fixed_integer_simple) {
+  fixed_integer<256> a = -5;
+  fixed_integer<256> b = 3;
+  EXPECT_EQ(-15, a * b);
+  EXPECT_EQ(-1, a / b);
+  EXPECT_EQ(-2, a % b);
+  EXPECT_EQ("-5", to_string(a));
+  EXPECT_EQ(-3, a >> 1);
+  EXPECT_TRUE(a < b);
+
+  fixed_integer<128> max = (fixed_integer<128>(1) << 127) - 1;
+  EXPECT_EQ(fixed_integer<128>(1) << 127, max + 1);
+  EXPECT_TRUE((max + 1).sign());
+  EXPECT_EQ(16u, sizeof(fixed_integer<128>));
+
+  std::ostringstream out;
+  out << fixed_integer<512>(std::string("-123456789012345678901234567890"));
+  EXPECT_EQ("-123456789012345678901234567890", out.str());
+}
+
+TEST(correctness_random, fixed_integer_division) {
+  // цифры из крайних значений: при них оценка цифры частного ошибается и частичный остаток уходит в минус
+  std::mt19937_64 rng(32);
+  const uint64_t patterns[] = {0, 1, 2, 1ULL << 63, (1ULL << 63) - 1, (1ULL << 63) + 1, ~0ULL, ~0ULL - 1};
+  auto pick = [&] { return patterns[rng() % (sizeof(patterns) / sizeof(patterns[0]))]; };
+  for (int iter = 0; iter < 2000; iter++) {
+    uint64_t x[4], y[4];
+    for (size_t i = 0; i < 4; i++) {
+      x[i] = pick();
+      y[i] = pick();
+    }
+    // делитель длины от 1 до 4 цифр, старшая цифра ненулевая
+    size_t m = rng() % 4 + 1;
+    std::fill(y + m, y + 4, 0);
+    if (y[m - 1] == 0) {
+      y[m - 1] = 1ULL << 63;
+    }
+    fixed_integer<256> a(big_integer().import_limbs(x, 4, -1, sizeof(uint64_t), 0));
+    fixed_integer<256> b(big_integer().import_limbs(y, 4, -1, sizeof(uint64_t), 0));
+    big_integer A = static_cast<big_integer>(a), B = static_cast<big_integer>(b);
+    EXPECT_EQ(wrap_to_bits<256>(A / B), static_cast<big_integer>(a / b)) << A << " / " << B;
+    EXPECT_EQ(A % B, static_cast<big_integer>(a % b)) << A << " % " << B;
+  }
+}
+
+TEST(correctness_random, mul_kernels) {
+  std::mt19937_64 rng(7);
+  const mul_kernels* portable = find_mul_kernels("portable");
+  ASSERT_NE(nullptr, portable);
+  EXPECT_EQ(nullptr, find_mul_kernels("no-such-kernels"));
+  for (const char* name : {"portable", "adx", "ifma", "bigasm"}) {
+    const mul_kernels* k = find_mul_kernels(name);
+    if (k == nullptr) {
+      continue;
+    }
+    for (int iter = 0; iter < 200; iter++) {
+      size_t an = rng() % 120 + 1, bn = rng() % 120 + 1;
+      std::vector<uint64_t> a(an), b(bn);
+      for (uint64_t& x : a) {
+        x = rng() % 4 == 0 ? ~0ULL : rng();
+      }
+      for (uint64_t& x : b) {
+        x = rng() % 4 == 0 ? ~0ULL : rng();
+      }
+      std::vector<uint64_t> r(an + bn), expected(an + bn);
+      k->mul_basecase(r.data(), a.data(), an, b.data(), bn);
+      static_assert(sizeof(mp_limb_t) == sizeof(uint64_t), "gmp limbs are 64-bit");
+      const uint64_t* x = an >= bn ? a.data() : b.data();
+      const uint64_t* y = an >= bn ? b.data() : a.data();
+      mpn_mul(reinterpret_cast<mp_limb_t*>(expected.data()), reinterpret_cast<const mp_limb_t*>(x),
+              std::max(an, bn), reinterpret_cast<const mp_limb_t*>(y), std::min(an, bn));
+      EXPECT_EQ(expected, r) << name;
+
+      std::vector<uint64_t> p1(an), p2(an);
+      uint64_t c1 = k->mul_1(p1.data(), a.data(), an, b[0]);
+      uint64_t c2 = portable->mul_1(p2.data(), a.data(), an, b[0]);
+      EXPECT_EQ(c2, c1) << name;
+      EXPECT_EQ(p2, p1) << name;
+      p1 = r;
+      p2 = r;
+      c1 = k->addmul_1(p1.data(), a.data(), an, b[0]);
+      c2 = portable->addmul_1(p2.data(), a.data(), an, b[0]);
+      EXPECT_EQ(c2, c1) << name;
+      EXPECT_EQ(p2, p1) << name;
+    }
+  }
+}
+
+namespace {
+// считается конструктором глобального объекта, возможно раньше выбора ядер для процессора
+const big_integer global_product = big_integer("123456789012345678901234567890123456789012345678901234567890")
+                                   * big_integer("987654321098765432109876543210987654321098765432109876543210");
+}
+
+TEST(correctness, limb_dispatch_global_constructor) {
+  EXPECT_EQ("1219326311370217952261850327338667885945115073915636335923673677792956119493974487120865336229233322"
+            "37463801111263526900",
+            to_string(global_product));
+}
+
+TEST(correctness, limb_dispatch_override) {
+  limb_dispatch_table best = make_limb_dispatch(nullptr);
+  EXPECT_NE(nullptr, find_mul_kernels(best.mul.name));
+  EXPECT_NE(nullptr, find_bitwise_kernels(best.bitwise.name));
+  EXPECT_NE(nullptr, find_addsub_kernels(best.addsub.name));
+  if (!big_integer::limb_traits::NATIVE_KERNELS) {
+    EXPECT_STREQ("portable", best.mul.name);
+    EXPECT_STREQ("scalar", best.bitwise.name);
+    EXPECT_STREQ("portable", best.addsub.name);
+  }
+
+  limb_dispatch_table forced = make_limb_dispatch("mul=portable,bitwise=scalar,addsub=portable");
+  EXPECT_STREQ("portable", forced.mul.name);
+  EXPECT_STREQ("scalar", forced.bitwise.name);
+  EXPECT_STREQ("portable", forced.addsub.name);
+  EXPECT_EQ(find_mul_kernels("portable")->mul_basecase, forced.mul.mul_basecase);
+
+  // неизвестные семейства и имена не меняют выбор по умолчанию
+  limb_dispatch_table bogus = make_limb_dispatch("mul=no-such-kernels,,simd=avx512,bitwise");
+  EXPECT_STREQ(best.mul.name, bogus.mul.name);
+  EXPECT_STREQ(best.bitwise.name, bogus.bitwise.name);
+  EXPECT_STREQ(best.addsub.name, bogus.addsub.name);
+
+  limb_dispatch_table partial = make_limb_dispatch("bitwise=scalar");
+  EXPECT_STREQ(best.mul.name, partial.mul.name);
+  EXPECT_STREQ("scalar", partial.bitwise.name);
+
+#ifdef BIGINT_HAVE_BIGASM
+  limb_dispatch_table bigasm = make_limb_dispatch("mul=bigasm,addsub=bigasm");
+  EXPECT_STREQ("bigasm", bigasm.mul.name);
+  EXPECT_STREQ("bigasm", bigasm.addsub.name);
+#endif
+}
+
+TEST(correctness_random, addsub_kernels) {
+  std::mt19937_64 rng(46);
+  for (const char* name : {"portable", "adc", "avx512", "bigasm"}) {
+    const addsub_kernels* k = find_addsub_kernels(name);
+    if (k == nullptr) {
+      continue;
+    }
+    for (int iter = 0; iter < 300; iter++) {
+      size_t n = rng() % 100 + 1;
+      // серии ~0 и 0 заставляют перенос и заём проходить через много цифр и целые векторы
+      std::vector<uint64_t> a(n), b(n);
+      for (size_t i = 0; i < n; i++) {
+        a[i] = rng() % 3 == 0 ? ~0ULL : rng();
+        b[i] = rng() % 3 == 0 ? 0 : rng() % 5 == 0 ? 1 : rng();
+      }
+      std::vector<uint64_t> r(n), expected(n);
+      uint64_t carry = k->add_n(r.data(), a.data(), b.data(), n);
+      uint64_t expected_carry = mpn_add_n(reinterpret_cast<mp_limb_t*>(expected.data()),
+                                          reinterpret_cast<const mp_limb_t*>(a.data()),
+                                          reinterpret_cast<const mp_limb_t*>(b.data()), n);
+      EXPECT_EQ(expected_carry, carry) << name;
+      EXPECT_EQ(expected, r) << name;
+
+      uint64_t borrow = k->sub_n(r.data(), b.data(), a.data(), n);
+      uint64_t expected_borrow = mpn_sub_n(reinterpret_cast<mp_limb_t*>(expected.data()),
+                                           reinterpret_cast<const mp_limb_t*>(b.data()),
+                                           reinterpret_cast<const mp_limb_t*>(a.data()), n);
+      EXPECT_EQ(expected_borrow, borrow) << name;
+      EXPECT_EQ(expected, r) << name;
+
+      // результат на месте первого операнда
+      std::vector<uint64_t> in_place = a;
+      k->add_n(in_place.data(), in_place.data(), b.data(), n);
+      k->sub_n(in_place.data(), in_place.data(), b.data(), n);
+      EXPECT_EQ(a, in_place) << name;
+    }
+  }
+}
+
+TEST(correctness, add_sub_long_carry) {
+  big_integer one = 1;
+  big_integer a = (one << 64 * 40) - 1;
+  EXPECT_EQ(one << 64 * 40, a + 1);
+  EXPECT_EQ(one << 64 * 40, 1 + a);
+  EXPECT_EQ(a, (a + 1) - 1);
+  EXPECT_EQ(-a, 1 - (a + 1));
+  EXPECT_EQ(big_integer(0), a - a);
+  EXPECT_EQ(a * 2, a + a);
+}
+
+TEST(correctness_random, limb_ops) {
+  std::mt19937_64 rng(47);
+  static_assert(sizeof(mp_limb_t) == sizeof(uint64_t), "gmp limbs are 64-bit");
+  auto mp = [](std::vector<uint64_t>& v) { return reinterpret_cast<mp_limb_t*>(v.data()); };
+  for (int iter = 0; iter < 300; iter++) {
+    size_t n = rng() % 50 + 1;
+    std::vector<uint64_t> a(n), b(n);
+    for (size_t i = 0; i < n; i++) {
+      a[i] = rng() % 3 == 0 ? ~0ULL : rng();
+      b[i] = rng() % 3 == 0 ? 0 : rng();
+    }
+    uint64_t x = rng() % 4 == 0 ? 1 : rng();
+    unsigned shift = static_cast<unsigned>(rng() % 63 + 1);
+    std::vector<uint64_t> r(n), expected(n);
+
+    EXPECT_EQ(mpn_add_1(mp(expected), mp(a), n, x), limb_add_1(r.data(), a.data(), n, x));
+    EXPECT_EQ(expected, r);
+    EXPECT_EQ(mpn_sub_1(mp(expected), mp(b), n, x), limb_sub_1(r.data(), b.data(), n, x));
+    EXPECT_EQ(expected, r);
+
+    r = b;
+    expected = b;
+    EXPECT_EQ(mpn_submul_1(mp(expected), mp(a), n, x), limb_submul_1(r.data(), a.data(), n, x));
+    EXPECT_EQ(expected, r);
+
+    EXPECT_EQ(mpn_lshift(mp(expected), mp(a), n, shift), limb_lshift(r.data(), a.data(), n, shift));
+    EXPECT_EQ(expected, r);
+    EXPECT_EQ(mpn_rshift(mp(expected), mp(a), n, shift), limb_rshift(r.data(), a.data(), n, shift));
+    EXPECT_EQ(expected, r);
+
+    EXPECT_EQ(mpn_divrem_1(mp(expected), 0, mp(a), n, x), limb_divrem_1(r.data(), a.data(), n, x));
+    EXPECT_EQ(expected, r);
+
+    int order = mpn_cmp(mp(a), mp(b), n);
+    EXPECT_EQ(order < 0 ? -1 : order > 0 ? 1 : 0, limb_cmp(a.data(), b.data(), n));
+    EXPECT_EQ(0, limb_cmp(a.data(), a.data(), n));
+  }
+}
+
+TEST(correctness, limb_ops_in_place) {
+  // ((2^128 - 1) * 3 + 5) / 3 в одном буфере
+  uint64_t digits[3] = {~0ULL, ~0ULL, 0};
+  digits[2] = limb_mul_1(digits, digits, 2, uint64_t(3));
+  EXPECT_EQ(0u, limb_add_1(digits, digits, 3, uint64_t(5)));
+  EXPECT_EQ(uint64_t(2), digits[0]);
+  EXPECT_EQ(uint64_t(0), digits[1]);
+  EXPECT_EQ(uint64_t(3), digits[2]);
+  EXPECT_EQ(uint64_t(2), limb_divrem_1(digits, digits, 3, uint64_t(3)));
+  EXPECT_EQ(uint64_t(0), digits[0]);
+  EXPECT_EQ(uint64_t(0), digits[1]);
+  EXPECT_EQ(uint64_t(1), digits[2]);
+
+  // сдвиг внутри одного буфера на цифру и бит вверх и обратно
+  uint32_t small[4] = {0x80000001u, 0x7fffffffu, 0, 0};
+  EXPECT_EQ(0u, limb_lshift(small + 1, small, 2, 1));
+  EXPECT_EQ(0x00000002u, small[1]);
+  EXPECT_EQ(0xffffffffu, small[2]);
+  EXPECT_EQ(0u, limb_rshift(small, small + 1, 3, 1));
+  EXPECT_EQ(0x80000001u, small[0]);
+  EXPECT_EQ(0x7fffffffu, small[1]);
+  EXPECT_EQ(0u, small[2]);
+}
+
+TEST(correctness_random, karatsuba_mul) {
+  std::mt19937_64 rng(49);
+  auto mp = [](const std::vector<uint64_t>& v) { return reinterpret_cast<const mp_limb_t*>(v.data()); };
+  // через пул идут уровни от PARALLEL_MUL_MIN_LIMBS цифр, поэтому нужны и такие длины
+  std::vector<std::pair<size_t, size_t>> sizes = {{24, 24}, {47, 47}, {48, 48}, {97, 49}, {300, 31}, {513, 512},
+                                                   {1000, 333}, {PARALLEL_MUL_MIN_LIMBS, PARALLEL_MUL_MIN_LIMBS},
+                                                   {2 * PARALLEL_MUL_MIN_LIMBS + 7, PARALLEL_MUL_MIN_LIMBS + 1}};
+  for (int iter = 0; iter < 20; iter++) {
+    sizes.emplace_back(rng() % 1500 + 1, rng() % 1500 + 1);
+  }
+  for (size_t threads : {1, 4}) {
+    set_bigint_threads(threads);
+    for (const std::pair<size_t, size_t>& size : sizes) {
+      size_t an = size.first, bn = size.second;
+      std::vector<uint64_t> a(an), b(bn);
+      // серии ~0 дают максимальные переносы и равные половины в разностях Карацубы
+      for (uint64_t& x : a) {
+        x = rng() % 4 == 0 ? ~0ULL : rng();
+      }
+      for (uint64_t& x : b) {
+        x = rng() % 4 == 0 ? ~0ULL : rng();
+      }
+      std::vector<uint64_t> r(an + bn), expected(an + bn);
+      limb_mul(r.data(), a.data(), an, b.data(), bn);
+      if (an >= bn) {
+        mpn_mul(reinterpret_cast<mp_limb_t*>(expected.data()), mp(a), an, mp(b), bn);
+      } else {
+        mpn_mul(reinterpret_cast<mp_limb_t*>(expected.data()), mp(b), bn, mp(a), an);
+      }
+      EXPECT_EQ(expected, r) << an << " x " << bn << ", threads " << threads;
+    }
+  }
+  set_bigint_threads(1);
+}
+
+TEST(correctness, parallel_mul_deterministic) {
+  big_integer a = (big_integer(1) << 64 * 5000) - 12345;
+  big_integer b = (big_integer(3) << 64 * 3000) + 777;
+  big_integer single = a * b;
+  set_bigint_threads(3);
+  EXPECT_EQ(3u, get_bigint_threads());
+  EXPECT_EQ(single, a * b);
+  EXPECT_EQ(single, b * a);
+  set_bigint_threads(1);
+  EXPECT_EQ(nullptr, bigint_thread_pool());
+  EXPECT_EQ(single / b, a);
+}
+
+TEST(correctness_random, decimal_tree) {
+  std::default_random_engine rng(50);
+  std::vector<size_t> sizes = {64 * 80, 64 * 81, 64 * 128, 64 * 1000 + 3, 64 * 4000};
+  for (int iter = 0; iter < 20; iter++) {
+    sizes.push_back(rng() % (64 * 3000) + 64 * 60);
+  }
+  for (size_t threads : {1, 4}) {
+    set_bigint_threads(threads);
+    for (size_t bits : sizes) {
+      big_integer_gmp a;
+      a.random(bits, rng);
+      std::string expected = to_string(a);
+      big_integer A(expected);
+      EXPECT_EQ(expected, to_string(A)) << bits << " bits, threads " << threads;
+      std::ostringstream out;
+      out << A;
+      EXPECT_EQ(expected, out.str());
+    }
+  }
+  set_bigint_threads(1);
+}
+
+TEST(correctness, decimal_tree_boundaries) {
+  // степени десяти и числа из девяток вокруг границ блоков, где частное по Барретту правится чаще всего
+  for (size_t digits : {1500, 1520, 1539, 2432, 4864, 9728}) {
+    std::string ten = "1" + std::string(digits, '0');
+    std::string nines(digits, '9');
+    big_integer power(ten);
+    EXPECT_EQ(ten, to_string(power));
+    EXPECT_EQ(nines, to_string(power - 1));
+    EXPECT_EQ("-" + nines, to_string(1 - power));
+    EXPECT_EQ("1" + std::string(digits - 1, '0') + "1", to_string(power + 1));
+    EXPECT_EQ(ten + std::string(digits, '0'), to_string(power * power));
+  }
+}
+
+TEST(correctness, thread_pool_task_group) {
+  thread_pool pool(4);
+  EXPECT_EQ(4u, pool.size());
+  std::atomic<int> sum(0);
+  {
+    thread_pool::task_group group(&pool);
+    for (int i = 1; i <= 100; i++) {
+      group.run([&, i] {
+        // вложенная группа: ожидающий поток сам выполняет задачи
+        thread_pool::task_group inner(&pool);
+        inner.run([&, i] { sum += i; });
+        inner.run([&, i] { sum += i; });
+        inner.wait();
+      });
+    }
+    group.wait();
+  }
+  EXPECT_EQ(2 * 5050, sum.load());
+
+  thread_pool::task_group failing(&pool);
+  failing.run([] { throw std::runtime_error("task failed"); });
+  failing.run([&] { sum += 1; });
+  EXPECT_THROW(failing.wait(), std::runtime_error);
+  EXPECT_EQ(2 * 5050 + 1, sum.load());
+
+  // без пула задачи выполняются сразу
+  thread_pool::task_group inline_group(nullptr);
+  inline_group.run([&] { sum = 0; });
+  EXPECT_EQ(0, sum.load());
+  inline_group.run([] { throw std::logic_error("inline"); });
+  EXPECT_THROW(inline_group.wait(), std::logic_error);
+}
+
+#ifdef BIGINT_HAVE_BIGASM
+TEST(correctness_random, bigasm_divrem_1) {
+  std::mt19937_64 rng(48);
+  for (int iter = 0; iter < 100; iter++) {
+    size_t n = rng() % 40;
+    std::vector<uint64_t> a(n), q(n), expected(n);
+    for (uint64_t& x : a) {
+      x = rng();
+    }
+    uint64_t d = rng() % 2 ? rng() | 1 : rng() % 1000 + 1;
+    uint64_t rem = bigasm_divrem_1(q.data(), a.data(), n, d);
+    EXPECT_EQ(limb_divrem_1(expected.data(), a.data(), n, d), rem);
+    EXPECT_EQ(expected, q);
+  }
+}
+#endif
+
+TEST(correctness_random, fixed_integer) {
+  check_fixed_integer_randomized<64>(321);
+  check_fixed_integer_randomized<256>(322);
+  check_fixed_integer_randomized<512>(323);
+  check_fixed_integer_randomized<1024>(324);
+}
+
+namespace {
+struct counting_limb_resource : limb_memory_resource {
+  size_t allocations = 0;
+  size_t live = 0;
+
+  void* allocate(size_t bytes, size_t align) override {
+    ++allocations;
+    ++live;
+    return new_delete_limb_resource()->allocate(bytes, align);
+  }
+
+  void deallocate(void* ptr, size_t bytes, size_t align) override {
+    --live;
+    new_delete_limb_resource()->deallocate(ptr, bytes, align);
+  }
+};
+}
+
+TEST(correctness, limb_resource_scope) {
+  counting_limb_resource counter;
+  std::string result;
+  {
+    limb_resource_scope scope(&counter);
+    big_integer a = big_integer(1) << 1000;
+    big_integer b = a * a - 1;
+    result = to_string(b / a);
+    EXPECT_GT(counter.allocations, 0u);
+  }
+  EXPECT_EQ(0u, counter.live);
+  EXPECT_EQ(limb_pool_resource(), get_limb_resource());
+  EXPECT_EQ(to_string((big_integer(1) << 1000) - 1), result);
+}
+
+TEST(correctness, parallel_mul_limb_resource) {
+  size_t an = 2 * PARALLEL_MUL_MIN_LIMBS + 7, bn = PARALLEL_MUL_MIN_LIMBS + 1;
+  std::vector<uint64_t> a(an, ~0ULL), b(bn, ~0ULL), expected(an + bn), r(an + bn);
+  for (size_t i = 0; i < an; i += 3) {
+    a[i] = i * 0x9e3779b97f4a7c15ULL;
+  }
+  limb_mul(expected.data(), a.data(), an, b.data(), bn);
+
+  // счётчик не потокобезопасен: задачи пула должны брать память из него, но под мьютексом
+  counting_limb_resource counter;
+  set_bigint_threads(4);
+  {
+    limb_resource_scope scope(&counter);
+    limb_mul(r.data(), a.data(), an, b.data(), bn);
+  }
+  set_bigint_threads(1);
+  EXPECT_EQ(expected, r);
+  // буфер нечётных кусков и по три буфера Карацубы на каждый из двух полных кусков
+  EXPECT_GE(counter.allocations, 7u);
+  EXPECT_EQ(0u, counter.live);
+}
+
+TEST(correctness, monotonic_limb_arena) {
+  big_integer outside = big_integer(1) << 500;
+  monotonic_limb_arena arena(256);
+  {
+    limb_resource_scope scope(&arena);
+    big_integer x = outside;
+    for (int i = 0; i < 100; i++) {
+      x = x * 3 + i;
+    }
+    x %= outside;
+    EXPECT_GT(arena.bytes_allocated(), 0u);
+    EXPECT_TRUE(0 <= x && x < outside);
+  }
+  arena.release();
+  EXPECT_EQ(0u, arena.bytes_allocated());
+  EXPECT_EQ(big_integer(1) << 500, outside);
+}
+
+TEST(correctness, self_aliasing_operations) {
+  big_integer const x = (big_integer(1) << 700) + 123456789;
+  big_integer a = x;
+  big_integer shared = a;
+  a += a;
+  EXPECT_EQ(x * 2, a);
+  a -= a;
+  EXPECT_EQ(0, a);
+  a = x;
+  a *= a;
+  EXPECT_EQ(x * x, a);
+  a /= a;
+  EXPECT_EQ(1, a);
+  a = -x;
+  a &= a;
+  EXPECT_EQ(-x, a);
+  EXPECT_EQ(x, shared);
+}
+
+TEST(correctness, storage_capacity) {
+  using storage = big_integer::storage_type;
+  using limb = big_integer::limb_type;
+  std::vector<limb> src(100);
+  for (size_t i = 0; i < src.size(); i++) {
+    src[i] = static_cast<limb>(i * 7 + 1);
+  }
+
+  storage a(src.data(), src.data() + src.size());
+  EXPECT_EQ(100u, a.size());
+  EXPECT_TRUE(std::equal(src.begin(), src.end(), a.cbegin()));
+
+  storage b(50, 3);
+  EXPECT_EQ(50u, b.size());
+  EXPECT_EQ(3u, b[49]);
+  b.reserve(1000);
+  EXPECT_GE(b.capacity(), 1000u);
+  const limb* before = b.cbegin();
+  b.resize(1000);
+  EXPECT_EQ(before, b.cbegin());
+  b.resize(60);
+  b.shrink_to_fit();
+  EXPECT_GE(b.capacity(), 60u);
+  EXPECT_LT(b.capacity(), 1000u);
+  // ёмкость уже совпадает с размером класса пула, повторный shrink_to_fit буфер не меняет
+  const limb* fitted = b.cbegin();
+  b.shrink_to_fit();
+  EXPECT_EQ(fitted, b.cbegin());
+  EXPECT_EQ(3u, b[49]);
+  EXPECT_EQ(0u, b[59]);
+
+  // общий буфер при shrink_to_fit не трогается
+  storage c = a;
+  c.resize(2);
+  storage d = c;
+  d.shrink_to_fit();
+  EXPECT_EQ(2u, d.size());
+  EXPECT_EQ(src[1], d[1]);
+  EXPECT_EQ(100u, a.size());
+
+  c.assign(src.data() + 10, src.data() + 90);
+  EXPECT_EQ(80u, c.size());
+  EXPECT_EQ(src[10], c[0]);
+  EXPECT_EQ(src[10], c.cbegin()[0]);
+}
+
+TEST(correctness, inline_storage_boundary) {
+  // числа от одной до нескольких цифр: переходы между встроенным буфером и кучей
+  for (int bits = 1; bits <= 600; bits += 31) {
+    big_integer a = (big_integer(1) << bits) - 1;
+    big_integer b = a;
+    b += 1;
+    EXPECT_EQ(big_integer(1) << bits, b);
+    EXPECT_EQ(a, b - 1);
+    EXPECT_EQ(a * a, (b << bits) - (b << 1) + 1);
+    EXPECT_EQ(a, a * a / a);
+    b = a;
+    b >>= bits;
+    EXPECT_EQ(0, b);
+  }
+}
+
+TEST(correctness, limb_pool_steady_state) {
+  big_integer a = (big_integer(1) << 3000) - 1;
+  big_integer b = (big_integer(1) << 1700) + 12345;
+  big_integer expected = a * b / (b - 1) % 1000000007;
+  EXPECT_EQ(expected, a * b / (b - 1) % 1000000007);
+
+  reset_limb_pool_stats();
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(expected, a * b / (b - 1) % 1000000007);
+  }
+  limb_pool_stats stats = get_limb_pool_stats();
+  EXPECT_GT(stats.hits, 0u);
+  EXPECT_EQ(0u, stats.misses);
+  EXPECT_GT(stats.cached, 0u);
+
+  trim_limb_pool();
+  EXPECT_EQ(0u, get_limb_pool_stats().cached);
+  EXPECT_EQ(0u, get_limb_pool_stats().cached_bytes);
+}
+
+namespace {
+// создаётся раньше первого обращения к пулу, а блок из пула получает уже в тесте;
+// при выходе разрушается после того места, где разрушился бы сам пул
+big_integer global_pooled_number;
+}
+
+TEST(correctness, limb_pool_outlives_globals) {
+  global_pooled_number = (big_integer(1) << 4000) + 1;
+  EXPECT_EQ(4001u, global_pooled_number.bit_length());
+}
+
+TEST(correctness, limb_pool_block_slack) {
+  using storage = big_integer::storage_type;
+  using limb = big_integer::limb_type;
+  // блок округляется до класса пула, и остаток класса идёт в ёмкость
+  storage s(32, 1);
+  EXPECT_GT(s.capacity(), 32u);
+  const limb* before = s.cbegin();
+  s.reserve(s.capacity());
+  while (s.size() < s.capacity()) {
+    s.push_back(2);
+  }
+  EXPECT_EQ(before, s.cbegin());
+}
+
+TEST(correctness, limb_pool_byte_limit) {
+  big_integer a = (big_integer(1) << 100000) - 1;
+  big_integer b = (big_integer(1) << 70000) + 12345;
+  big_integer expected = a * b / (b - 1) % 1000000007;
+
+  set_limb_pool_max_bytes(64 << 10);
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(expected, a * b / (b - 1) % 1000000007);
+    EXPECT_LE(get_limb_pool_stats().cached_bytes, size_t(64 << 10));
+  }
+  set_limb_pool_max_bytes(0);
+  EXPECT_EQ(0u, get_limb_pool_stats().cached);
+  EXPECT_EQ(0u, get_limb_pool_stats().cached_bytes);
+
+  set_limb_pool_max_bytes(LIMB_POOL_DEFAULT_MAX_BYTES);
+  EXPECT_EQ(expected, a * b / (b - 1) % 1000000007);
+  EXPECT_LE(get_limb_pool_stats().cached_bytes, LIMB_POOL_DEFAULT_MAX_BYTES);
+}
+
+#ifdef BIGINT_ATOMIC_REFCOUNT
+TEST(correctness, shared_between_threads) {
+  big_integer const shared = (big_integer(1) << 5000) - 12345;
+  std::string const expected = to_string(shared + 1);
+  size_t const expected_hash = std::hash<big_integer>()(big_integer(to_string(shared)));
+
+  std::vector<std::thread> threads;
+  std::vector<int> failures(4);
+  for (size_t t = 0; t < failures.size(); t++) {
+    threads.emplace_back([&shared, &expected, expected_hash, &failures, t] {
+      for (int i = 0; i < 200; i++) {
+        big_integer copy = shared;
+        failures[t] += std::hash<big_integer>()(copy) != expected_hash;
+        copy += 1;
+        failures[t] += to_string(copy) != expected;
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (int f : failures) {
+    EXPECT_EQ(0, f);
+  }
+  EXPECT_EQ(expected, to_string(shared + 1));
+}
+#endif
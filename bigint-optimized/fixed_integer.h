@@ -0,0 +1,401 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include "big_integer.h"
+#include "limb_ops.h"
+
+/*
+ * fixed_integer<Bits> -- целое фиксированной ширины в дополнительном коде.
+ * data_ содержит Bits / 64 цифр по основанию 2^64, младшие первыми,
+ * и лежит целиком внутри объекта. Арифметика ведётся по модулю 2^Bits,
+ * деление и остаток, как у big_integer, округляют к нулю.
+ *
+ * Циклы по цифрам разворачиваются на этапе компиляции через unroll_;
+ * деление -- поцифровое, через limb_ops.h
+ */
+
+namespace fixed_integer_detail {
+    __extension__ typedef unsigned __int128 uint128_t;
+
+    template <size_t I, size_t N>
+    struct unroll_ {
+        template <typename F>
+        static void apply(F& f) {
+            f(I);
+            unroll_<I + 1, N>::apply(f);
+        }
+    };
+
+    template <size_t N>
+    struct unroll_<N, N> {
+        template <typename F>
+        static void apply(F&) { }
+    };
+}
+
+template <size_t Bits>
+class fixed_integer {
+    static_assert(Bits > 0 && Bits % 64 == 0, "fixed_integer width must be a positive multiple of 64");
+
+ public:
+    static constexpr size_t LIMBS = Bits / 64;
+
+ private:
+    using uint128_t = fixed_integer_detail::uint128_t;
+    using storage_t = std::array<uint64_t, LIMBS>;
+
+    storage_t data_;
+
+    template <typename F>
+    static void for_each_limb_(F f) {
+        fixed_integer_detail::unroll_<0, LIMBS>::apply(f);
+    }
+
+    void assign_signed_(long long val) {
+        uint64_t fill = val < 0 ? ~0ULL : 0ULL;
+        for_each_limb_([&](size_t i) { data_[i] = fill; });
+        data_[0] = static_cast<uint64_t>(val);
+    }
+
+    void assign_unsigned_(unsigned long long val) {
+        for_each_limb_([&](size_t i) { data_[i] = 0; });
+        data_[0] = val;
+    }
+
+    void negate_() {
+        bool carry = true;
+        for_each_limb_([&](size_t i) {
+            data_[i] = ~data_[i] + carry;
+            carry = carry && data_[i] == 0;
+        });
+    }
+
+    fixed_integer abs_() const {
+        return sign() ? -(*this) : (*this);
+    }
+
+    static bool less_unsigned_(const storage_t& left, const storage_t& right) {
+        for (size_t i = LIMBS; i --> 0; ) {
+            if (left[i] != right[i]) {
+                return left[i] < right[i];
+            }
+        }
+        return false;
+    }
+
+    static size_t bit_length_unsigned_(const storage_t& val) {
+        for (size_t i = LIMBS; i --> 0; ) {
+            if (val[i] != 0) {
+                return i * 64 + 64 - __builtin_clzll(val[i]);
+            }
+        }
+        return 0;
+    }
+
+    /*
+     * Беззнаковое деление с остатком, right != 0: нормализованное поцифровое
+     * деление (алгоритм D Кнута) на цифрах из limb_ops.h, как в big_integer::operator/=,
+     * только временные массивы фиксированного размера и лежат на стеке
+     */
+    static void div_mod_unsigned_(const storage_t& left, const storage_t& right, storage_t& quot, storage_t& rem) {
+        quot = storage_t();
+        rem = storage_t();
+        size_t n = (bit_length_unsigned_(left) + 63) / 64, m = (bit_length_unsigned_(right) + 63) / 64;
+        // LIMBS == 1 проверяется отдельно, чтобы компилятор не разбирал ветку ниже для одной цифры
+        if (LIMBS == 1 || m == 1) {
+            rem[0] = limb_divrem_1(quot.data(), left.data(), LIMBS, right[0]);
+            return;
+        }
+        if (n < m) {
+            rem = left;
+            return;
+        }
+
+        // после сдвига старший бит делителя -- единица, и оценка цифры частного ошибается не больше чем на 2
+        unsigned shift = static_cast<unsigned>(__builtin_clzll(right[m - 1]));
+        std::array<uint64_t, LIMBS + 1> u;
+        storage_t d;
+        u[n] = limb_lshift(u.data(), left.data(), n, shift);
+        limb_lshift(d.data(), right.data(), m, shift);
+        const uint64_t d_top = d[m - 1];
+        for (size_t k = n - m + 1; k --> 0; ) {
+            uint64_t qt = u[k + m] >= d_top
+                          ? ~0ULL
+                          : static_cast<uint64_t>((static_cast<uint128_t>(u[k + m]) << 64 | u[k + m - 1]) / d_top);
+            uint64_t borrow = limb_submul_1(u.data() + k, d.data(), m, qt);
+            uint64_t top = u[k + m];
+            u[k + m] = top - borrow;
+            if (top < borrow) {
+                do {
+                    --qt;
+                    top = u[k + m];
+                    u[k + m] += limb_add_n(u.data() + k, u.data() + k, d.data(), m);
+                } while (u[k + m] >= top);
+            }
+            quot[k] = qt;
+        }
+        limb_rshift(rem.data(), u.data(), m, shift);
+    }
+
+    fixed_integer& div_mod_(const fixed_integer& right, bool want_quot) {
+        assert(right != fixed_integer());
+        bool left_sign = sign();
+        bool quot_sign = left_sign ^ right.sign();
+        storage_t quot, rem;
+        div_mod_unsigned_(abs_().data_, right.abs_().data_, quot, rem);
+        data_ = want_quot ? quot : rem;
+        if (want_quot ? quot_sign : left_sign) {
+            negate_();
+        }
+        return (*this);
+    }
+
+ public:
+    fixed_integer() : data_() { }
+    fixed_integer(const int& val) { assign_signed_(val); }
+    fixed_integer(const long& val) { assign_signed_(val); }
+    fixed_integer(const long long& val) { assign_signed_(val); }
+    fixed_integer(const unsigned& val) { assign_unsigned_(val); }
+    fixed_integer(const unsigned long& val) { assign_unsigned_(val); }
+    fixed_integer(const unsigned long long& val) { assign_unsigned_(val); }
+    fixed_integer(const fixed_integer&) = default;
+    fixed_integer& operator=(const fixed_integer&) = default;
+
+    // младшие Bits бит числа в дополнительном коде
+    explicit fixed_integer(const big_integer& val) : data_() {
+        if (val.export_size(sizeof(uint64_t)) <= LIMBS) {
+            val.export_limbs(data_.data(), -1, sizeof(uint64_t), 0);
+        } else {
+            std::vector<uint64_t> all(val.export_size(sizeof(uint64_t)));
+            val.export_limbs(all.data(), -1, sizeof(uint64_t), 0);
+            std::copy_n(all.begin(), LIMBS, data_.begin());
+        }
+        if (val.sign()) {
+            negate_();
+        }
+    }
+
+    explicit fixed_integer(const std::string& str) : fixed_integer(big_integer(str)) { }
+
+    explicit operator big_integer() const {
+        fixed_integer abs = abs_();
+        return big_integer().import_limbs(abs.data_.data(), LIMBS, -1, sizeof(uint64_t), 0, sign());
+    }
+
+    bool sign() const {
+        return data_[LIMBS - 1] >> 63;
+    }
+
+    const uint64_t* limbs() const {
+        return data_.data();
+    }
+
+    fixed_integer& operator+=(const fixed_integer& right) {
+        uint64_t carry = 0;
+        for_each_limb_([&](size_t i) {
+            uint128_t sum = static_cast<uint128_t>(data_[i]) + right.data_[i] + carry;
+            data_[i] = static_cast<uint64_t>(sum);
+            carry = static_cast<uint64_t>(sum >> 64);
+        });
+        return (*this);
+    }
+
+    fixed_integer& operator-=(const fixed_integer& right) {
+        uint64_t borrow = 0;
+        for_each_limb_([&](size_t i) {
+            uint128_t diff = static_cast<uint128_t>(data_[i]) - right.data_[i] - borrow;
+            data_[i] = static_cast<uint64_t>(diff);
+            borrow = static_cast<uint64_t>(diff >> 64) & 1ULL;
+        });
+        return (*this);
+    }
+
+    // произведение по модулю 2^Bits: старшие цифры не вычисляются
+    fixed_integer& operator*=(const fixed_integer& right) {
+        storage_t result = storage_t();
+        for_each_limb_([&](size_t i) {
+            uint64_t carry = 0;
+            for (size_t j = 0; i + j < LIMBS; j++) {
+                uint128_t cur = static_cast<uint128_t>(data_[i]) * right.data_[j] + result[i + j] + carry;
+                result[i + j] = static_cast<uint64_t>(cur);
+                carry = static_cast<uint64_t>(cur >> 64);
+            }
+        });
+        data_ = result;
+        return (*this);
+    }
+
+    fixed_integer& operator/=(const fixed_integer& right) {
+        return div_mod_(right, true);
+    }
+
+    fixed_integer& operator%=(const fixed_integer& right) {
+        return div_mod_(right, false);
+    }
+
+    // арифметический сдвиг, как у big_integer
+    fixed_integer& operator>>=(uint64_t right) {
+        uint64_t fill = sign() ? ~0ULL : 0ULL;
+        size_t digits = right >= Bits ? LIMBS : right / 64;
+        unsigned bits = right >= Bits ? 0 : right % 64;
+        for_each_limb_([&](size_t i) {
+            uint64_t lo = i + digits < LIMBS ? data_[i + digits] : fill;
+            uint64_t hi = i + digits + 1 < LIMBS ? data_[i + digits + 1] : fill;
+            data_[i] = bits == 0 ? lo : lo >> bits | hi << (64 - bits);
+        });
+        return (*this);
+    }
+
+    fixed_integer& operator<<=(uint64_t right) {
+        size_t digits = right >= Bits ? LIMBS : right / 64;
+        unsigned bits = right >= Bits ? 0 : right % 64;
+        for (size_t i = LIMBS; i --> 0; ) {
+            uint64_t lo = i >= digits ? data_[i - digits] : 0;
+            uint64_t lower = i >= digits + 1 ? data_[i - digits - 1] : 0;
+            data_[i] = bits == 0 ? lo : lo << bits | lower >> (64 - bits);
+        }
+        return (*this);
+    }
+
+    fixed_integer& operator&=(const fixed_integer& right) {
+        for_each_limb_([&](size_t i) { data_[i] &= right.data_[i]; });
+        return (*this);
+    }
+
+    fixed_integer& operator|=(const fixed_integer& right) {
+        for_each_limb_([&](size_t i) { data_[i] |= right.data_[i]; });
+        return (*this);
+    }
+
+    fixed_integer& operator^=(const fixed_integer& right) {
+        for_each_limb_([&](size_t i) { data_[i] ^= right.data_[i]; });
+        return (*this);
+    }
+
+    fixed_integer& operator++() {
+        return (*this) += 1;
+    }
+
+    fixed_integer operator++(int) {
+        fixed_integer t(*this);
+        (*this) += 1;
+        return t;
+    }
+
+    fixed_integer& operator--() {
+        return (*this) -= 1;
+    }
+
+    fixed_integer operator--(int) {
+        fixed_integer t(*this);
+        (*this) -= 1;
+        return t;
+    }
+
+    friend bool operator==(const fixed_integer& left, const fixed_integer& right) {
+        return left.data_ == right.data_;
+    }
+
+    friend bool operator!=(const fixed_integer& left, const fixed_integer& right) {
+        return !(left == right);
+    }
+
+    friend bool operator<(const fixed_integer& left, const fixed_integer& right) {
+        if (left.sign() != right.sign()) {
+            return left.sign();
+        }
+        return less_unsigned_(left.data_, right.data_);
+    }
+
+    friend bool operator<=(const fixed_integer& left, const fixed_integer& right) {
+        return !(right < left);
+    }
+
+    friend bool operator>(const fixed_integer& left, const fixed_integer& right) {
+        return right < left;
+    }
+
+    friend bool operator>=(const fixed_integer& left, const fixed_integer& right) {
+        return !(left < right);
+    }
+
+    friend fixed_integer operator+(fixed_integer left, const fixed_integer& right) {
+        return left += right;
+    }
+
+    friend fixed_integer operator-(fixed_integer left, const fixed_integer& right) {
+        return left -= right;
+    }
+
+    friend fixed_integer operator*(fixed_integer left, const fixed_integer& right) {
+        return left *= right;
+    }
+
+    friend fixed_integer operator/(fixed_integer left, const fixed_integer& right) {
+        return left /= right;
+    }
+
+    friend fixed_integer operator%(fixed_integer left, const fixed_integer& right) {
+        return left %= right;
+    }
+
+    friend fixed_integer operator<<(fixed_integer left, uint64_t right) {
+        return left <<= right;
+    }
+
+    friend fixed_integer operator>>(fixed_integer left, uint64_t right) {
+        return left >>= right;
+    }
+
+    friend fixed_integer operator&(fixed_integer left, const fixed_integer& right) {
+        return left &= right;
+    }
+
+    friend fixed_integer operator|(fixed_integer left, const fixed_integer& right) {
+        return left |= right;
+    }
+
+    friend fixed_integer operator^(fixed_integer left, const fixed_integer& right) {
+        return left ^= right;
+    }
+
+    friend fixed_integer operator-(const fixed_integer& val) {
+        fixed_integer result(val);
+        result.negate_();
+        return result;
+    }
+
+    friend fixed_integer operator+(const fixed_integer& val) {
+        return val;
+    }
+
+    friend fixed_integer operator~(const fixed_integer& val) {
+        fixed_integer result(val);
+        result.for_each_limb_([&](size_t i) { result.data_[i] = ~result.data_[i]; });
+        return result;
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, const fixed_integer& num) {
+        return out << static_cast<big_integer>(num);
+    }
+
+    friend std::istream& operator>>(std::istream& in, fixed_integer& num) {
+        big_integer val;
+        if (in >> val) {
+            num = fixed_integer(val);
+        }
+        return in;
+    }
+
+    friend std::string to_string(const fixed_integer& num) {
+        return to_string(static_cast<big_integer>(num));
+    }
+};
+
+template <size_t Bits>
+constexpr size_t fixed_integer<Bits>::LIMBS;
@@ -0,0 +1,117 @@
+#include <cstdio>
+#include <string>
+#include "limb_dispatch.h"
+#include "limb_traits.h"
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+namespace {
+#if defined(__x86_64__)
+    // AVX2 и AVX-512 требуют, чтобы ОС сохраняла ymm (XCR0: биты 1, 2) и zmm (биты 5, 6, 7)
+    bool os_saves_state_(unsigned mask) {
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || (ecx & bit_OSXSAVE) == 0) {
+            return false;
+        }
+        unsigned xcr0_lo, xcr0_hi;
+        __asm__("xgetbv" : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0));
+        return (xcr0_lo & mask) == mask;
+    }
+#endif
+
+    cpu_features probe_cpu_features_() {
+        cpu_features features = {false, false, false, false};
+#if defined(__x86_64__)
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            return features;
+        }
+        bool ymm = os_saves_state_(0x6), zmm = os_saves_state_(0xE6);
+        features.adx = (ebx & bit_BMI2) != 0 && (ebx & bit_ADX) != 0;
+        features.avx2 = ymm && (ebx & bit_AVX2) != 0;
+        features.avx512f = zmm && (ebx & bit_AVX512F) != 0;
+        features.avx512ifma = features.avx512f && (ebx & bit_AVX512IFMA) != 0;
+#endif
+        return features;
+    }
+
+    // наборы в порядке предпочтения; find_*_kernels отсеивает неподдерживаемые
+    const mul_kernels* best_mul_kernels_() {
+        for (const char* name : {"ifma", "adx"}) {
+            if (const mul_kernels* k = find_mul_kernels(name)) {
+                return k;
+            }
+        }
+        return find_mul_kernels("portable");
+    }
+
+    const bitwise_kernels* best_bitwise_kernels_() {
+        for (const char* name : {"avx512", "avx2"}) {
+            if (const bitwise_kernels* k = find_bitwise_kernels(name)) {
+                return k;
+            }
+        }
+        return find_bitwise_kernels("scalar");
+    }
+
+    const addsub_kernels* best_addsub_kernels_() {
+        for (const char* name : {"avx512", "adc"}) {
+            if (const addsub_kernels* k = find_addsub_kernels(name)) {
+                return k;
+            }
+        }
+        return find_addsub_kernels("portable");
+    }
+
+    template <typename Kernels>
+    void override_kernels_(Kernels& target, const Kernels* found, const std::string& entry) {
+        if (found != nullptr) {
+            target = *found;
+        } else {
+            std::fprintf(stderr, "BIGINT_KERNELS: '%s' is unknown or not supported by this CPU, using %s\n",
+                         entry.c_str(), target.name);
+        }
+    }
+}
+
+
+const cpu_features& host_cpu_features() {
+    static const cpu_features features = probe_cpu_features_();
+    return features;
+}
+
+
+limb_dispatch_table make_limb_dispatch(const char* spec) {
+    limb_dispatch_table table = {*find_mul_kernels("portable"), *find_bitwise_kernels("scalar"),
+                                 *find_addsub_kernels("portable")};
+    if (BIGINT_LIMB_TRAITS::NATIVE_KERNELS) {
+        table = {*best_mul_kernels_(), *best_bitwise_kernels_(), *best_addsub_kernels_()};
+    }
+    if (spec == nullptr) {
+        return table;
+    }
+    std::string rest(spec);
+    while (!rest.empty()) {
+        size_t comma = rest.find(',');
+        std::string entry = rest.substr(0, comma);
+        rest = comma == std::string::npos ? "" : rest.substr(comma + 1);
+        if (entry.empty()) {
+            continue;
+        }
+        size_t eq = entry.find('=');
+        std::string family = entry.substr(0, eq);
+        const char* name = eq == std::string::npos ? "" : entry.c_str() + eq + 1;
+        if (family == "mul") {
+            override_kernels_(table.mul, find_mul_kernels(name), entry);
+        } else if (family == "bitwise") {
+            override_kernels_(table.bitwise, find_bitwise_kernels(name), entry);
+        } else if (family == "addsub") {
+            override_kernels_(table.addsub, find_addsub_kernels(name), entry);
+        } else {
+            std::fprintf(stderr, "BIGINT_KERNELS: unknown kernel family in '%s'\n", entry.c_str());
+        }
+    }
+    return table;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "limb_kernels.h"
+
+/*
+ * Выбор ядер над цифрами для текущего процессора. cpuid опрашивается
+ * один раз, и по его результату при инициализации программы таблица
+ * LIMB_DISPATCH заполняется копиями выбранных наборов ядер, так что
+ * вызов ядра -- это одно косвенное обращение через статическую таблицу.
+ *
+ * Переменная окружения BIGINT_KERNELS позволяет выбрать реализации
+ * вручную, например для замеров каждой из них:
+ *
+ *     BIGINT_KERNELS=mul=adx,bitwise=avx2,addsub=portable
+ *
+ * Неупомянутые семейства получают лучший набор для процессора, а если
+ * политика цифры запрещает ассемблер (NATIVE_KERNELS в limb_traits.h) --
+ * переносимый. Неизвестное имя или набор, который процессор не
+ * поддерживает, игнорируются с предупреждением в stderr
+ */
+
+struct cpu_features {
+    bool adx;         // BMI2 mulx и ADX adcx/adox
+    bool avx2;
+    bool avx512f;
+    bool avx512ifma;
+};
+
+// возможности процессора и ОС (сохраняет ли она ymm/zmm); на не-x86 всё false
+const cpu_features& host_cpu_features();
+
+struct limb_dispatch_table {
+    mul_kernels mul;
+    bitwise_kernels bitwise;
+    addsub_kernels addsub;
+};
+
+// таблица по строке в формате BIGINT_KERNELS; spec == nullptr -- наборы по умолчанию
+limb_dispatch_table make_limb_dispatch(const char* spec);
+
+// до динамической инициализации -- переносимые наборы (константная инициализация),
+// затем make_limb_dispatch(getenv("BIGINT_KERNELS")); поэтому ядра можно вызывать
+// и из конструкторов глобальных объектов
+extern limb_dispatch_table LIMB_DISPATCH;
+
+inline const limb_dispatch_table& limb_dispatch() {
+    return LIMB_DISPATCH;
+}
+
+inline uint64_t limb_mul_1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b) {
+    return LIMB_DISPATCH.mul.mul_1(r, a, n, b);
+}
+
+inline uint64_t limb_addmul_1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b) {
+    return LIMB_DISPATCH.mul.addmul_1(r, a, n, b);
+}
+
+inline void limb_mul_basecase(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b, size_t bn) {
+    LIMB_DISPATCH.mul.mul_basecase(r, a, an, b, bn);
+}
+
+inline void limb_bitwise_n(limb_bitwise_op op, uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n,
+                           uint64_t ma, uint64_t mb) {
+    LIMB_DISPATCH.bitwise.ops[op](r, a, b, n, ma, mb);
+}
+
+inline uint64_t limb_add_n(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+    return LIMB_DISPATCH.addsub.add_n(r, a, b, n);
+}
+
+inline uint64_t limb_sub_n(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+    return LIMB_DISPATCH.addsub.sub_n(r, a, b, n);
+}
@@ -0,0 +1,601 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "limb_dispatch.h"
+#include "limb_kernels.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#ifdef BIGINT_HAVE_BIGASM
+#include "bigasm.h"
+#endif
+
+namespace {
+    __extension__ typedef unsigned __int128 uint128_t;
+
+    struct portable_kernels_ {
+        static uint64_t mul_1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b) {
+            uint64_t carry = 0;
+            for (size_t i = 0; i < n; i++) {
+                uint128_t p = static_cast<uint128_t>(a[i]) * b + carry;
+                r[i] = static_cast<uint64_t>(p);
+                carry = static_cast<uint64_t>(p >> 64);
+            }
+            return carry;
+        }
+
+        // a[i] * b + r[i] + carry <= 2^128 - 1, поэтому переполнения нет
+        static uint64_t addmul_1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b) {
+            uint64_t carry = 0;
+            for (size_t i = 0; i < n; i++) {
+                uint128_t p = static_cast<uint128_t>(a[i]) * b + r[i] + carry;
+                r[i] = static_cast<uint64_t>(p);
+                carry = static_cast<uint64_t>(p >> 64);
+            }
+            return carry;
+        }
+    };
+
+#if defined(__x86_64__)
+    /*
+     * mulx не трогает флаги, поэтому перенос от старших половин произведений
+     * идёт по CF (adcx), а перенос от прибавления r[i] -- по OF (adox).
+     * Счётчик живёт в rcx и проверяется jrcxz, который флаги тоже не меняет.
+     * Основной цикл развёрнут на 4 цифры, остаток n % 4 проходится по одной
+     */
+    struct adx_kernels_ {
+        static uint64_t mul_1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b) {
+            uint64_t carry = mul_1_step_(r, a, n % 4, b, 0);
+            size_t done = n % 4;
+            return n / 4 == 0 ? carry : mul_1_unrolled_(r + done, a + done, n / 4, b, carry);
+        }
+
+        static uint64_t addmul_1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b) {
+            uint64_t carry = addmul_1_step_(r, a, n % 4, b, 0);
+            size_t done = n % 4;
+            return n / 4 == 0 ? carry : addmul_1_unrolled_(r + done, a + done, n / 4, b, carry);
+        }
+
+     private:
+        static uint64_t mul_1_step_(uint64_t* r, const uint64_t* a, size_t n, uint64_t b, uint64_t carry) {
+            for (size_t i = 0; i < n; i++) {
+                uint128_t p = static_cast<uint128_t>(a[i]) * b + carry;
+                r[i] = static_cast<uint64_t>(p);
+                carry = static_cast<uint64_t>(p >> 64);
+            }
+            return carry;
+        }
+
+        static uint64_t addmul_1_step_(uint64_t* r, const uint64_t* a, size_t n, uint64_t b, uint64_t carry) {
+            for (size_t i = 0; i < n; i++) {
+                uint128_t p = static_cast<uint128_t>(a[i]) * b + r[i] + carry;
+                r[i] = static_cast<uint64_t>(p);
+                carry = static_cast<uint64_t>(p >> 64);
+            }
+            return carry;
+        }
+
+        // blocks >= 1 блоков по 4 цифры
+        static uint64_t mul_1_unrolled_(uint64_t* r, const uint64_t* a, size_t blocks, uint64_t b,
+                                        uint64_t carry) {
+            uint64_t lo0, lo1, hi;
+            size_t i = 0;
+            __asm__("xor %k[lo0], %k[lo0]\n\t"
+                    "1:\n\t"
+                    "mulx (%[a],%[i],8), %[lo0], %[hi]\n\t"
+                    "adcx %[carry], %[lo0]\n\t"
+                    "mov %[lo0], (%[r],%[i],8)\n\t"
+                    "mulx 8(%[a],%[i],8), %[lo1], %[carry]\n\t"
+                    "adcx %[hi], %[lo1]\n\t"
+                    "mov %[lo1], 8(%[r],%[i],8)\n\t"
+                    "mulx 16(%[a],%[i],8), %[lo0], %[hi]\n\t"
+                    "adcx %[carry], %[lo0]\n\t"
+                    "mov %[lo0], 16(%[r],%[i],8)\n\t"
+                    "mulx 24(%[a],%[i],8), %[lo1], %[carry]\n\t"
+                    "adcx %[hi], %[lo1]\n\t"
+                    "mov %[lo1], 24(%[r],%[i],8)\n\t"
+                    "lea 4(%[i]), %[i]\n\t"
+                    "lea -1(%[n]), %[n]\n\t"
+                    "jrcxz 2f\n\t"
+                    "jmp 1b\n"
+                    "2:\n\t"
+                    "mov $0, %k[lo0]\n\t"
+                    "adcx %[lo0], %[carry]\n\t"
+            : [lo0] "=&r" (lo0), [lo1] "=&r" (lo1), [hi] "=&r" (hi), [carry] "+&r" (carry), [i] "+&r" (i),
+              [n] "+&c" (blocks)
+            : [a] "r" (a), [r] "r" (r), "d" (b)
+            : "cc", "memory");
+            return carry;
+        }
+
+        static uint64_t addmul_1_unrolled_(uint64_t* r, const uint64_t* a, size_t blocks, uint64_t b,
+                                           uint64_t carry) {
+            uint64_t lo0, lo1, hi;
+            size_t i = 0;
+            __asm__("xor %k[lo0], %k[lo0]\n\t"
+                    "1:\n\t"
+                    "mulx (%[a],%[i],8), %[lo0], %[hi]\n\t"
+                    "adcx %[carry], %[lo0]\n\t"
+                    "adox (%[r],%[i],8), %[lo0]\n\t"
+                    "mov %[lo0], (%[r],%[i],8)\n\t"
+                    "mulx 8(%[a],%[i],8), %[lo1], %[carry]\n\t"
+                    "adcx %[hi], %[lo1]\n\t"
+                    "adox 8(%[r],%[i],8), %[lo1]\n\t"
+                    "mov %[lo1], 8(%[r],%[i],8)\n\t"
+                    "mulx 16(%[a],%[i],8), %[lo0], %[hi]\n\t"
+                    "adcx %[carry], %[lo0]\n\t"
+                    "adox 16(%[r],%[i],8), %[lo0]\n\t"
+                    "mov %[lo0], 16(%[r],%[i],8)\n\t"
+                    "mulx 24(%[a],%[i],8), %[lo1], %[carry]\n\t"
+                    "adcx %[hi], %[lo1]\n\t"
+                    "adox 24(%[r],%[i],8), %[lo1]\n\t"
+                    "mov %[lo1], 24(%[r],%[i],8)\n\t"
+                    "lea 4(%[i]), %[i]\n\t"
+                    "lea -1(%[n]), %[n]\n\t"
+                    "jrcxz 2f\n\t"
+                    "jmp 1b\n"
+                    "2:\n\t"
+                    "mov $0, %k[lo0]\n\t"
+                    "adcx %[lo0], %[carry]\n\t"
+                    "adox %[lo0], %[carry]\n\t"
+            : [lo0] "=&r" (lo0), [lo1] "=&r" (lo1), [hi] "=&r" (hi), [carry] "+&r" (carry), [i] "+&r" (i),
+              [n] "+&c" (blocks)
+            : [a] "r" (a), [r] "r" (r), "d" (b)
+            : "cc", "memory");
+            return carry;
+        }
+    };
+
+    /*
+     * Умножение в системе счисления 2^52 на AVX-512 IFMA. vpmadd52luq и
+     * vpmadd52huq прибавляют к 64-битным ячейкам младшие и старшие 52 бита
+     * произведений 52-битных цифр; старшие половины относятся к следующей
+     * цифре, поэтому копятся отдельно, и перенос раскладывается один раз в
+     * конце. Каждые 8 цифр результата накапливаются в регистрах по всем
+     * подходящим цифрам b, так что на две инструкции IFMA приходится одна
+     * загрузка. В ячейку попадает не больше min(an52, bn52) слагаемых
+     * меньше 2^52, и при IFMA_MAX_DIGITS52 = 4096 переполнения нет
+     */
+    const size_t IFMA_MAX_DIGITS52 = 4096;
+    const uint64_t MASK52 = (uint64_t(1) << 52) - 1;
+
+    size_t digits52_(size_t n) {
+        return (64 * n + 51) / 52;
+    }
+
+    void to_radix52_(uint64_t* dst, const uint64_t* src, size_t n) {
+        for (size_t k = 0, count = digits52_(n); k < count; k++) {
+            size_t pos = 52 * k, word = pos / 64, off = pos % 64;
+            uint64_t v = src[word] >> off;
+            if (off > 12 && word + 1 < n) {
+                v |= src[word + 1] << (64 - off);
+            }
+            dst[k] = v & MASK52;
+        }
+    }
+
+    // lo[k] -- вклад в цифру k, hi[k] -- в цифру k + 1; результат пишется в r[0, rn)
+    void from_radix52_(uint64_t* r, size_t rn, const uint64_t* lo, const uint64_t* hi, size_t count) {
+        uint128_t carry = 0, acc = 0;
+        size_t bits = 0, out = 0;
+        for (size_t k = 0; k <= count && out < rn; k++) {
+            uint128_t t = carry + (k < count ? lo[k] : 0) + (k > 0 ? hi[k - 1] : 0);
+            carry = t >> 52;
+            acc |= (t & MASK52) << bits;
+            bits += 52;
+            if (bits >= 64 && out < rn) {
+                r[out++] = static_cast<uint64_t>(acc);
+                acc >>= 64;
+                bits -= 64;
+            }
+        }
+        while (out < rn) {
+            r[out++] = static_cast<uint64_t>(acc);
+            acc >>= 64;
+        }
+    }
+
+    __attribute__((target("avx512f,avx512ifma")))
+    void mul_ifma_(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b, size_t bn) {
+        size_t a52 = digits52_(an), b52 = digits52_(bn);
+        size_t count = (a52 + b52 + 7) & ~size_t(7);
+
+        // перед цифрами a и после них по 8 нулей: окно из 8 цифр может выходить за края
+        thread_local std::vector<uint64_t> scratch;
+        scratch.assign(a52 + 16 + b52 + 2 * count, 0);
+        uint64_t* a_d = scratch.data() + 8;
+        uint64_t* b_d = a_d + a52 + 8;
+        uint64_t* lo = b_d + b52;
+        uint64_t* hi = lo + count;
+        to_radix52_(a_d, a, an);
+        to_radix52_(b_d, b, bn);
+
+        for (size_t k = 0; k < count; k += 8) {
+            // цифры k..k+7 получают a[k + t - j] * b[j] при k - a52 < j <= k + 7
+            size_t first = k + 1 > a52 ? k + 1 - a52 : 0;
+            size_t last = std::min(b52, k + 8);
+            __m512i lo0 = _mm512_setzero_si512(), lo1 = _mm512_setzero_si512();
+            __m512i hi0 = _mm512_setzero_si512(), hi1 = _mm512_setzero_si512();
+            size_t j = first;
+            for (; j + 1 < last; j += 2) {
+                __m512i a0 = _mm512_loadu_si512(a_d + k - j);
+                __m512i a1 = _mm512_loadu_si512(a_d + k - j - 1);
+                __m512i b0 = _mm512_set1_epi64(static_cast<long long>(b_d[j]));
+                __m512i b1 = _mm512_set1_epi64(static_cast<long long>(b_d[j + 1]));
+                lo0 = _mm512_madd52lo_epu64(lo0, a0, b0);
+                hi0 = _mm512_madd52hi_epu64(hi0, a0, b0);
+                lo1 = _mm512_madd52lo_epu64(lo1, a1, b1);
+                hi1 = _mm512_madd52hi_epu64(hi1, a1, b1);
+            }
+            if (j < last) {
+                __m512i a0 = _mm512_loadu_si512(a_d + k - j);
+                __m512i b0 = _mm512_set1_epi64(static_cast<long long>(b_d[j]));
+                lo0 = _mm512_madd52lo_epu64(lo0, a0, b0);
+                hi0 = _mm512_madd52hi_epu64(hi0, a0, b0);
+            }
+            _mm512_storeu_si512(lo + k, _mm512_add_epi64(lo0, lo1));
+            _mm512_storeu_si512(hi + k, _mm512_add_epi64(hi0, hi1));
+        }
+        from_radix52_(r, an + bn, lo, hi, count);
+    }
+#endif
+
+    // строки произведения складываются ядрами Kernels без косвенных вызовов
+    template <typename Kernels>
+    void mul_basecase_(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b, size_t bn) {
+        if (an < bn) {
+            std::swap(a, b);
+            std::swap(an, bn);
+        }
+        r[an] = Kernels::mul_1(r, a, an, b[0]);
+        for (size_t j = 1; j < bn; j++) {
+            r[an + j] = Kernels::addmul_1(r + j, a, an, b[j]);
+        }
+    }
+
+    /*
+     * Таблицы инициализируются статически, так что ими можно пользоваться из конструкторов глобальных объектов.
+     * Порог Карацубы подобран по замерам: с mulx и без него рекурсия выигрывает уже с 24 цифр
+     */
+    constexpr mul_kernels PORTABLE_KERNELS = {"portable", &portable_kernels_::mul_1, &portable_kernels_::addmul_1,
+                                              &mul_basecase_<portable_kernels_>, 24};
+#if defined(__x86_64__)
+    const mul_kernels ADX_KERNELS = {"adx", &adx_kernels_::mul_1, &adx_kernels_::addmul_1,
+                                     &mul_basecase_<adx_kernels_>, 24};
+
+    // на коротких числах перевод в систему 2^52 и обратно дороже выигрыша: при 24 цифрах IFMA и mulx
+    // идут вровень, к 256 цифрам IFMA быстрее в 4 раза
+    const size_t IFMA_MIN_LIMBS = 28;
+
+    void mul_basecase_ifma_(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b, size_t bn) {
+        if (std::min(an, bn) >= IFMA_MIN_LIMBS && std::min(digits52_(an), digits52_(bn)) <= IFMA_MAX_DIGITS52) {
+            mul_ifma_(r, a, an, b, bn);
+        } else {
+            mul_basecase_<adx_kernels_>(r, a, an, b, bn);
+        }
+    }
+
+    const mul_kernels IFMA_KERNELS = {"ifma", &adx_kernels_::mul_1, &adx_kernels_::addmul_1, &mul_basecase_ifma_,
+                                      256};  // IFMA-умножение квадратичное, но быстрое: Карацуба догоняет его к 256 цифрам
+#endif
+
+#ifdef BIGINT_HAVE_BIGASM
+    // подпрограммы из ../asm/bigasm.asm: mul и adc по одной цифре за итерацию, как в исходных add.asm и mul.asm
+    const mul_kernels BIGASM_KERNELS = {"bigasm", &bigasm_mul_1, &bigasm_addmul_1, &bigasm_mul_basecase, 24};
+#endif
+}
+
+
+const mul_kernels* find_mul_kernels(const char* name) {
+    if (std::strcmp(name, PORTABLE_KERNELS.name) == 0) {
+        return &PORTABLE_KERNELS;
+    }
+#if defined(__x86_64__)
+    if (std::strcmp(name, ADX_KERNELS.name) == 0 && host_cpu_features().adx) {
+        return &ADX_KERNELS;
+    }
+    if (std::strcmp(name, IFMA_KERNELS.name) == 0 && host_cpu_features().adx && host_cpu_features().avx512ifma) {
+        return &IFMA_KERNELS;
+    }
+#endif
+#ifdef BIGINT_HAVE_BIGASM
+    if (std::strcmp(name, BIGASM_KERNELS.name) == 0) {
+        return &BIGASM_KERNELS;
+    }
+#endif
+    return nullptr;
+}
+
+
+
+namespace {
+    template <limb_bitwise_op Op>
+    void bitwise_scalar_(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n, uint64_t ma, uint64_t mb) {
+        for (size_t i = 0; i < n; i++) {
+            r[i] = limb_apply_bitwise(Op, a[i] ^ ma, b[i] ^ mb);
+        }
+    }
+
+    constexpr bitwise_kernels SCALAR_BITWISE = {"scalar", {&bitwise_scalar_<LIMB_BITWISE_AND>,
+                                                           &bitwise_scalar_<LIMB_BITWISE_OR>,
+                                                           &bitwise_scalar_<LIMB_BITWISE_XOR>}};
+
+#if defined(__x86_64__)
+    template <limb_bitwise_op Op>
+    __attribute__((target("avx2")))
+    __m256i apply_avx2_(__m256i x, __m256i y) {
+        return Op == LIMB_BITWISE_AND ? _mm256_and_si256(x, y)
+             : Op == LIMB_BITWISE_OR ? _mm256_or_si256(x, y)
+             : _mm256_xor_si256(x, y);
+    }
+
+    template <limb_bitwise_op Op>
+    __attribute__((target("avx2")))
+    void bitwise_avx2_(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n, uint64_t ma, uint64_t mb) {
+        __m256i va = _mm256_set1_epi64x(static_cast<long long>(ma));
+        __m256i vb = _mm256_set1_epi64x(static_cast<long long>(mb));
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256i x = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)), va);
+            __m256i y = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)), vb);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(r + i), apply_avx2_<Op>(x, y));
+        }
+        bitwise_scalar_<Op>(r + i, a + i, b + i, n - i, ma, mb);
+    }
+
+    /*
+     * Непосредственный операнд vpternlogq для (a ^ ma) op (b ^ mb) при масках
+     * ma, mb из {0, 1}: бит с номером 4a + 2b + c -- значение на этих битах
+     * входов (третий вход не влияет). Так маски и операция применяются одной
+     * инструкцией
+     */
+    constexpr int ternary_imm_(limb_bitwise_op op, int ma, int mb, int i = 0) {
+        return i == 8 ? 0
+             : ((op == LIMB_BITWISE_AND ? (((i >> 2) & 1) ^ ma) & (((i >> 1) & 1) ^ mb)
+               : op == LIMB_BITWISE_OR ? (((i >> 2) & 1) ^ ma) | (((i >> 1) & 1) ^ mb)
+               : (((i >> 2) & 1) ^ ma) ^ (((i >> 1) & 1) ^ mb)) << i) | ternary_imm_(op, ma, mb, i + 1);
+    }
+
+    template <int Imm>
+    __attribute__((target("avx512f")))
+    void bitwise_avx512_imm_(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m512i x = _mm512_loadu_si512(a + i);
+            __m512i y = _mm512_loadu_si512(b + i);
+            _mm512_storeu_si512(r + i, _mm512_ternarylogic_epi64(x, y, y, Imm));
+        }
+        // хвост короче вектора -- через маску, без скалярного цикла
+        if (i < n) {
+            __mmask8 tail = static_cast<__mmask8>((1U << (n - i)) - 1);
+            __m512i x = _mm512_maskz_loadu_epi64(tail, a + i);
+            __m512i y = _mm512_maskz_loadu_epi64(tail, b + i);
+            _mm512_mask_storeu_epi64(r + i, tail, _mm512_ternarylogic_epi64(x, y, y, Imm));
+        }
+    }
+
+    // маски 0 или ~0, поэтому вариантов на операцию четыре, и выбор делается один раз на вызов
+    template <limb_bitwise_op Op>
+    void bitwise_avx512_(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n, uint64_t ma, uint64_t mb) {
+        if (ma == 0) {
+            if (mb == 0) {
+                bitwise_avx512_imm_<ternary_imm_(Op, 0, 0)>(r, a, b, n);
+            } else {
+                bitwise_avx512_imm_<ternary_imm_(Op, 0, 1)>(r, a, b, n);
+            }
+        } else {
+            if (mb == 0) {
+                bitwise_avx512_imm_<ternary_imm_(Op, 1, 0)>(r, a, b, n);
+            } else {
+                bitwise_avx512_imm_<ternary_imm_(Op, 1, 1)>(r, a, b, n);
+            }
+        }
+    }
+
+    const bitwise_kernels AVX2_BITWISE = {"avx2", {&bitwise_avx2_<LIMB_BITWISE_AND>, &bitwise_avx2_<LIMB_BITWISE_OR>,
+                                                   &bitwise_avx2_<LIMB_BITWISE_XOR>}};
+    const bitwise_kernels AVX512_BITWISE = {"avx512", {&bitwise_avx512_<LIMB_BITWISE_AND>,
+                                                       &bitwise_avx512_<LIMB_BITWISE_OR>,
+                                                       &bitwise_avx512_<LIMB_BITWISE_XOR>}};
+#endif
+}
+
+
+const bitwise_kernels* find_bitwise_kernels(const char* name) {
+    if (std::strcmp(name, SCALAR_BITWISE.name) == 0) {
+        return &SCALAR_BITWISE;
+    }
+#if defined(__x86_64__)
+    if (std::strcmp(name, AVX2_BITWISE.name) == 0 && host_cpu_features().avx2) {
+        return &AVX2_BITWISE;
+    }
+    if (std::strcmp(name, AVX512_BITWISE.name) == 0 && host_cpu_features().avx512f) {
+        return &AVX512_BITWISE;
+    }
+#endif
+    return nullptr;
+}
+
+
+
+namespace {
+    struct portable_addsub_ {
+        static uint64_t add_n(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+            uint64_t carry = 0;
+            for (size_t i = 0; i < n; i++) {
+                uint64_t s = a[i] + carry;
+                carry = s < carry;
+                r[i] = s + b[i];
+                carry += r[i] < s;
+            }
+            return carry;
+        }
+
+        static uint64_t sub_n(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+            uint64_t borrow = 0;
+            for (size_t i = 0; i < n; i++) {
+                uint64_t d = a[i] - borrow;
+                borrow = a[i] < borrow;
+                borrow += d < b[i];
+                r[i] = d - b[i];
+            }
+            return borrow;
+        }
+    };
+
+    constexpr addsub_kernels PORTABLE_ADDSUB = {"portable", &portable_addsub_::add_n, &portable_addsub_::sub_n};
+
+#if defined(__x86_64__)
+    // перенос между вызовами _addcarry_u64 компилятор держит во флаге CF
+    struct adc_addsub_ {
+        static uint64_t add_n(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+            return add_n_from(r, a, b, n, 0);
+        }
+
+        static uint64_t sub_n(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+            return sub_n_from(r, a, b, n, 0);
+        }
+
+        static uint64_t add_n_from(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n, uint64_t carry) {
+            unsigned char c = static_cast<unsigned char>(carry);
+            unsigned long long s0, s1, s2, s3;
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                c = _addcarry_u64(c, a[i], b[i], &s0);
+                c = _addcarry_u64(c, a[i + 1], b[i + 1], &s1);
+                c = _addcarry_u64(c, a[i + 2], b[i + 2], &s2);
+                c = _addcarry_u64(c, a[i + 3], b[i + 3], &s3);
+                r[i] = s0;
+                r[i + 1] = s1;
+                r[i + 2] = s2;
+                r[i + 3] = s3;
+            }
+            for (; i < n; i++) {
+                c = _addcarry_u64(c, a[i], b[i], &s0);
+                r[i] = s0;
+            }
+            return c;
+        }
+
+        static uint64_t sub_n_from(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n, uint64_t borrow) {
+            unsigned char c = static_cast<unsigned char>(borrow);
+            unsigned long long d0, d1, d2, d3;
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                c = _subborrow_u64(c, a[i], b[i], &d0);
+                c = _subborrow_u64(c, a[i + 1], b[i + 1], &d1);
+                c = _subborrow_u64(c, a[i + 2], b[i + 2], &d2);
+                c = _subborrow_u64(c, a[i + 3], b[i + 3], &d3);
+                r[i] = d0;
+                r[i + 1] = d1;
+                r[i + 2] = d2;
+                r[i + 3] = d3;
+            }
+            for (; i < n; i++) {
+                c = _subborrow_u64(c, a[i], b[i], &d0);
+                r[i] = d0;
+            }
+            return c;
+        }
+    };
+
+    /*
+     * Перенос с предвычислением: в блоке из 8 цифр g -- маска ячеек, где
+     * сумма переполнилась, p -- маска ячеек, равных ~0 (они передают
+     * входящий перенос дальше). Входящие переносы ячеек -- это
+     * ((g << 1 | c) + p) ^ p: сложение масок как 8-битных чисел прогоняет
+     * перенос через серии единиц p, а девятый бит -- перенос из блока.
+     * g и p не пересекаются, поэтому девятый бит не больше 1.
+     * Для вычитания g -- ячейки с заёмом, p -- нулевые ячейки разности
+     */
+    __attribute__((target("avx512f")))
+    uint64_t add_n_avx512_(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+        const __m512i ones = _mm512_set1_epi64(-1), one = _mm512_set1_epi64(1);
+        unsigned carry = 0;
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m512i x = _mm512_loadu_si512(a + i);
+            __m512i s = _mm512_add_epi64(x, _mm512_loadu_si512(b + i));
+            unsigned g = _mm512_cmplt_epu64_mask(s, x);
+            unsigned p = _mm512_cmpeq_epi64_mask(s, ones);
+            unsigned t = ((g << 1) | carry) + p;
+            carry = t >> 8;
+            _mm512_storeu_si512(r + i, _mm512_mask_add_epi64(s, static_cast<__mmask8>(t ^ p), s, one));
+        }
+        return adc_addsub_::add_n_from(r + i, a + i, b + i, n - i, carry);
+    }
+
+    __attribute__((target("avx512f")))
+    uint64_t sub_n_avx512_(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+        const __m512i one = _mm512_set1_epi64(1);
+        unsigned borrow = 0;
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m512i x = _mm512_loadu_si512(a + i);
+            __m512i y = _mm512_loadu_si512(b + i);
+            __m512i d = _mm512_sub_epi64(x, y);
+            unsigned g = _mm512_cmplt_epu64_mask(x, y);
+            unsigned p = _mm512_cmpeq_epi64_mask(d, _mm512_setzero_si512());
+            unsigned t = ((g << 1) | borrow) + p;
+            borrow = t >> 8;
+            _mm512_storeu_si512(r + i, _mm512_mask_sub_epi64(d, static_cast<__mmask8>(t ^ p), d, one));
+        }
+        return adc_addsub_::sub_n_from(r + i, a + i, b + i, n - i, borrow);
+    }
+
+    // до 8 цифр вектор не заполняется, с 16 цифр предвычисление быстрее цепочки adc вдвое
+    const size_t ADDSUB_SIMD_MIN_LIMBS = 16;
+
+    uint64_t add_n_lookahead_(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+        return n >= ADDSUB_SIMD_MIN_LIMBS ? add_n_avx512_(r, a, b, n) : adc_addsub_::add_n(r, a, b, n);
+    }
+
+    uint64_t sub_n_lookahead_(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+        return n >= ADDSUB_SIMD_MIN_LIMBS ? sub_n_avx512_(r, a, b, n) : adc_addsub_::sub_n(r, a, b, n);
+    }
+
+    const addsub_kernels ADC_ADDSUB = {"adc", &adc_addsub_::add_n, &adc_addsub_::sub_n};
+    const addsub_kernels AVX512_ADDSUB = {"avx512", &add_n_lookahead_, &sub_n_lookahead_};
+#endif
+
+#ifdef BIGINT_HAVE_BIGASM
+    const addsub_kernels BIGASM_ADDSUB = {"bigasm", &bigasm_add_n, &bigasm_sub_n};
+#endif
+}
+
+
+const addsub_kernels* find_addsub_kernels(const char* name) {
+    if (std::strcmp(name, PORTABLE_ADDSUB.name) == 0) {
+        return &PORTABLE_ADDSUB;
+    }
+#if defined(__x86_64__)
+    if (std::strcmp(name, ADC_ADDSUB.name) == 0) {
+        return &ADC_ADDSUB;
+    }
+    if (std::strcmp(name, AVX512_ADDSUB.name) == 0 && host_cpu_features().avx512f) {
+        return &AVX512_ADDSUB;
+    }
+#endif
+#ifdef BIGINT_HAVE_BIGASM
+    if (std::strcmp(name, BIGASM_ADDSUB.name) == 0) {
+        return &BIGASM_ADDSUB;
+    }
+#endif
+    return nullptr;
+}
+
+
+/*
+ * Таблица определена здесь, рядом с переносимыми наборами: её начальное значение --
+ * константное выражение, поэтому она заполнена ещё до динамической инициализации,
+ * и конструкторы глобальных чисел в любой единице трансляции вызывают рабочие ядра.
+ * Затем, во время динамической инициализации, наборы заменяются выбранными для процессора
+ */
+limb_dispatch_table LIMB_DISPATCH = {PORTABLE_KERNELS, SCALAR_BITWISE, PORTABLE_ADDSUB};
+
+namespace {
+    const bool LIMB_DISPATCH_SELECTED = (LIMB_DISPATCH = make_limb_dispatch(std::getenv("BIGINT_KERNELS")), true);
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Ядра умножения над массивами цифр, младшие цифры первыми.
+ *
+ * Для 64-битных цифр реализаций несколько: умножение средних чисел в
+ * системе 2^52 на AVX-512 IFMA, BMI2 mulx с двумя цепочками переносов
+ * ADX (adcx/adox) и переносимый вариант на unsigned __int128. Какая из
+ * них вызывается, решает limb_dispatch (см. limb_dispatch.h). Для
+ * 32-битных цифр хватает uint64_t, и ядра встраиваются прямо здесь
+ */
+
+// r[0, n) = a[0, n) * b, возвращает старшую цифру; r может совпадать с a
+using mul_1_fn = uint64_t (*)(uint64_t* r, const uint64_t* a, size_t n, uint64_t b);
+
+// r[0, n) += a[0, n) * b, возвращает перенос
+using addmul_1_fn = uint64_t (*)(uint64_t* r, const uint64_t* a, size_t n, uint64_t b);
+
+// r[0, an + bn) = a[0, an) * b[0, bn); an, bn >= 1, r не пересекается с a и b
+using mul_basecase_fn = void (*)(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b, size_t bn);
+
+struct mul_kernels {
+    const char* name;
+    mul_1_fn mul_1;
+    addmul_1_fn addmul_1;
+    mul_basecase_fn mul_basecase;
+    size_t karatsuba_min_limbs;  // с какой длины меньшего множителя Карацуба быстрее mul_basecase (см. limb_mul.h)
+};
+
+// "portable", "adx", "ifma" или "bigasm" (при сборке с BIGINT_WITH_BIGASM);
+// nullptr, если процессор не поддерживает нужные инструкции
+const mul_kernels* find_mul_kernels(const char* name);
+
+inline uint32_t limb_mul_1(uint32_t* r, const uint32_t* a, size_t n, uint32_t b) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t p = static_cast<uint64_t>(a[i]) * b + carry;
+        r[i] = static_cast<uint32_t>(p);
+        carry = p >> 32;
+    }
+    return static_cast<uint32_t>(carry);
+}
+
+inline uint32_t limb_addmul_1(uint32_t* r, const uint32_t* a, size_t n, uint32_t b) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t p = static_cast<uint64_t>(a[i]) * b + r[i] + carry;
+        r[i] = static_cast<uint32_t>(p);
+        carry = p >> 32;
+    }
+    return static_cast<uint32_t>(carry);
+}
+
+inline void limb_mul_basecase(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn) {
+    r[an] = limb_mul_1(r, a, an, b[0]);
+    for (size_t j = 1; j < bn; j++) {
+        r[an + j] = limb_addmul_1(r + j, a, an, b[j]);
+    }
+}
+
+/*
+ * Побитовые операции над массивами цифр. Маски ma и mb равны 0 или ~0:
+ * старшие цифры отрицательного числа в дополнительном коде -- это
+ * инвертированные цифры модуля, и ядро получает их без отдельного прохода.
+ * Реализации -- AVX-512, AVX2 и скалярная
+ */
+enum limb_bitwise_op {
+    LIMB_BITWISE_AND,
+    LIMB_BITWISE_OR,
+    LIMB_BITWISE_XOR
+};
+
+template <typename T>
+inline T limb_apply_bitwise(limb_bitwise_op op, T x, T y) {
+    return op == LIMB_BITWISE_AND ? x & y : op == LIMB_BITWISE_OR ? x | y : x ^ y;
+}
+
+// r[i] = (a[i] ^ ma) op (b[i] ^ mb); r может совпадать с a или b
+using bitwise_n_fn = void (*)(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n, uint64_t ma, uint64_t mb);
+
+struct bitwise_kernels {
+    const char* name;
+    bitwise_n_fn ops[3];  // по индексу limb_bitwise_op
+};
+
+// "scalar", "avx2" или "avx512"; nullptr, если процессор не поддерживает нужные инструкции
+const bitwise_kernels* find_bitwise_kernels(const char* name);
+
+inline void limb_bitwise_n(limb_bitwise_op op, uint32_t* r, const uint32_t* a, const uint32_t* b, size_t n,
+                           uint32_t ma, uint32_t mb) {
+    for (size_t i = 0; i < n; i++) {
+        r[i] = limb_apply_bitwise(op, a[i] ^ ma, b[i] ^ mb);
+    }
+}
+
+/*
+ * Сложение и вычитание массивов цифр одинаковой длины. Скалярные ядра --
+ * цепочки _addcarry_u64/_subborrow_u64, развёрнутые на 4 цифры; на длинных
+ * числах AVX-512 складывает по 8 цифр и разрешает переносы внутри вектора
+ * предвычислением по маскам, так что на блок приходится один скалярный
+ * перенос. Реализация с векторной частью сама выбирает ядро по длине
+ */
+
+// r[0, n) = a[0, n) + b[0, n), возвращает перенос; r может совпадать с a или b
+using add_n_fn = uint64_t (*)(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n);
+
+// r[0, n) = a[0, n) - b[0, n), возвращает заём; r может совпадать с a или b
+using sub_n_fn = uint64_t (*)(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n);
+
+struct addsub_kernels {
+    const char* name;
+    add_n_fn add_n;
+    sub_n_fn sub_n;
+};
+
+// "portable", "adc", "avx512" или "bigasm" (при сборке с BIGINT_WITH_BIGASM);
+// nullptr, если процессор не поддерживает нужные инструкции
+const addsub_kernels* find_addsub_kernels(const char* name);
+
+inline uint32_t limb_add_n(uint32_t* r, const uint32_t* a, const uint32_t* b, size_t n) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t s = static_cast<uint64_t>(a[i]) + b[i] + carry;
+        r[i] = static_cast<uint32_t>(s);
+        carry = s >> 32;
+    }
+    return static_cast<uint32_t>(carry);
+}
+
+inline uint32_t limb_sub_n(uint32_t* r, const uint32_t* a, const uint32_t* b, size_t n) {
+    uint64_t borrow = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t d = static_cast<uint64_t>(a[i]) - b[i] - borrow;
+        r[i] = static_cast<uint32_t>(d);
+        borrow = d >> 63;
+    }
+    return static_cast<uint32_t>(borrow);
+}
@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "limb_mul.h"
+#include "limb_ops.h"
+#include "limb_resource.h"
+#include "thread_pool.h"
+
+namespace {
+    template <typename T>
+    using limb_buffer_ = std::vector<T, limb_allocator<T>>;
+
+    // задача пула берёт память из того же источника, что и вызвавший её поток
+    template <typename F>
+    std::function<void()> with_resource_(F task) {
+        limb_memory_resource* resource = get_limb_resource();
+        return [=] {
+            limb_resource_scope scope(resource);
+            task();
+        };
+    }
+
+    /*
+     * Пользовательский источник (например, арена) не обязан быть
+     * потокобезопасным, поэтому задачи пула обращаются к нему под мьютексом
+     */
+    struct locked_resource_ : limb_memory_resource {
+        explicit locked_resource_(limb_memory_resource* upstream)
+                : upstream(upstream) { }
+
+        void* allocate(size_t bytes, size_t align) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            return upstream->allocate(bytes, align);
+        }
+
+        void deallocate(void* ptr, size_t bytes, size_t align) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            upstream->deallocate(ptr, bytes, align);
+        }
+
+        size_t usable_size(size_t bytes, size_t align) const override {
+            return upstream->usable_size(bytes, align);
+        }
+
+        limb_memory_resource* upstream;
+        std::mutex mutex;
+    };
+
+    bool thread_safe_resource_(limb_memory_resource* resource) {
+        return resource == limb_pool_resource() || resource == new_delete_limb_resource();
+    }
+    // d[0, h) = |x[0, m) - y[0, h)|, m <= h; возвращает true, если x < y
+    template <typename T>
+    bool abs_diff_(T* d, const T* x, size_t m, const T* y, size_t h) {
+        size_t top = h;
+        while (top > m && y[top - 1] == 0) {
+            top--;
+        }
+        bool less = top > m || limb_cmp(x, y, m) < 0;
+        if (less) {
+            T borrow = limb_sub_n(d, y, x, m);
+            limb_sub_1(d + m, y + m, h - m, borrow);
+        } else {
+            // x >= y, значит старшие цифры y нулевые
+            limb_sub_n(d, x, y, m);
+            std::fill(d + m, d + h, T(0));
+        }
+        return less;
+    }
+
+    // временная память karatsuba_ на n цифрах: на каждом уровне 6h + 1 цифр, h = ceil(n / 2)
+    size_t karatsuba_scratch_(size_t n, size_t base) {
+        size_t total = 0;
+        while (n >= base) {
+            size_t h = n - n / 2;
+            total += 6 * h + 1;
+            n = h;
+        }
+        return total;
+    }
+
+    template <typename T>
+    void karatsuba_(T* r, const T* a, const T* b, size_t n, size_t base, T* scratch, thread_pool* pool);
+
+    // то же с собственной временной памятью, для задач пула
+    template <typename T>
+    void karatsuba_alloc_(T* r, const T* a, const T* b, size_t n, size_t base, thread_pool* pool) {
+        limb_buffer_<T> scratch(karatsuba_scratch_(n, base));
+        karatsuba_(r, a, b, n, base, scratch.data(), pool);
+    }
+
+    // r[0, 2n) = a[0, n) * b[0, n); до base цифр -- mul_basecase
+    template <typename T>
+    void karatsuba_(T* r, const T* a, const T* b, size_t n, size_t base, T* scratch, thread_pool* pool) {
+        if (n < base) {
+            limb_mul_basecase(r, a, n, b, n);
+            return;
+        }
+        size_t m = n / 2, h = n - m;
+        T* da = scratch;
+        T* db = da + h;
+        T* t = db + h;
+        T* mid = t + 2 * h;
+        T* child = mid + 2 * h + 1;
+
+        // (a0 - a1)(b0 - b1) = +-t, t = |a0 - a1| * |b0 - b1|
+        bool negative = abs_diff_(da, a, m, a + m, h) != abs_diff_(db, b, m, b + m, h);
+        if (pool != nullptr && n >= PARALLEL_MUL_MIN_LIMBS) {
+            thread_pool::task_group group(pool);
+            group.run(with_resource_([=] { karatsuba_alloc_(r, a, b, m, base, pool); }));
+            group.run(with_resource_([=] { karatsuba_alloc_(r + 2 * m, a + m, b + m, h, base, pool); }));
+            karatsuba_(t, da, db, h, base, child, pool);
+            group.wait();
+        } else {
+            karatsuba_(r, a, b, m, base, child, pool);
+            karatsuba_(r + 2 * m, a + m, b + m, h, base, child, pool);
+            karatsuba_(t, da, db, h, base, child, pool);
+        }
+
+        // mid = z0 + z2 - (a0 - a1)(b0 - b1) = a0 * b1 + a1 * b0 < B^(2h + 1)
+        std::copy(r + 2 * m, r + 2 * n, mid);
+        T carry = limb_add_n(mid, mid, r, 2 * m);
+        carry = limb_add_1(mid + 2 * m, mid + 2 * m, 2 * h - 2 * m, carry);
+        if (negative) {
+            carry += limb_add_n(mid, mid, t, 2 * h);
+        } else {
+            carry -= limb_sub_n(mid, mid, t, 2 * h);
+        }
+        mid[2 * h] = carry;
+        carry = limb_add_n(r + m, r + m, mid, 2 * h + 1);
+        limb_add_1(r + m + 2 * h + 1, r + m + 2 * h + 1, m - 1, carry);
+    }
+
+    inline size_t karatsuba_base_(const uint64_t*) {
+        return limb_dispatch().mul.karatsuba_min_limbs;
+    }
+
+    inline size_t karatsuba_base_(const uint32_t*) {
+        return KARATSUBA_MIN_LIMBS_32;
+    }
+
+    template <typename T>
+    void mul_(T* r, const T* a, size_t an, const T* b, size_t bn) {
+        if (an < bn) {
+            std::swap(a, b);
+            std::swap(an, bn);
+        }
+        size_t base = std::max<size_t>(karatsuba_base_(r), 4);
+        if (bn < base) {
+            limb_mul_basecase(r, a, an, b, bn);
+            return;
+        }
+        thread_pool* pool = bigint_thread_pool();
+        limb_memory_resource* resource = get_limb_resource();
+        std::unique_ptr<locked_resource_> locked;
+        if (pool != nullptr && bn >= PARALLEL_MUL_MIN_LIMBS && !thread_safe_resource_(resource)) {
+            locked.reset(new locked_resource_(resource));
+        }
+        limb_resource_scope scope(locked != nullptr ? locked.get() : resource);
+        if (an == bn) {
+            limb_buffer_<T> scratch(karatsuba_scratch_(bn, base));
+            karatsuba_(r, a, b, bn, base, scratch.data(), pool);
+            return;
+        }
+
+        /*
+         * Куски a по bn цифр: произведения соседних кусков перекрываются на bn
+         * цифр, поэтому чётные пишутся прямо в r, а нечётные -- во временный
+         * буфер и прибавляются после
+         */
+        size_t chunks = (an + bn - 1) / bn;
+        limb_buffer_<T> odd(chunks / 2 * 2 * bn);
+        std::fill(r, r + an + bn, T(0));
+        {
+            thread_pool::task_group group(bn >= PARALLEL_MUL_MIN_LIMBS ? pool : nullptr);
+            for (size_t k = 0; k < chunks; k++) {
+                const T* chunk = a + k * bn;
+                size_t c = std::min(bn, an - k * bn);
+                T* dst = k % 2 == 0 ? r + k * bn : odd.data() + k / 2 * 2 * bn;
+                group.run(with_resource_([=] {
+                    if (c == bn) {
+                        karatsuba_alloc_(dst, chunk, b, bn, base, pool);
+                    } else {
+                        mul_(dst, b, bn, chunk, c);
+                    }
+                }));
+            }
+            group.wait();
+        }
+        for (size_t k = 1; k < chunks; k += 2) {
+            size_t c = std::min(bn, an - k * bn), len = c + bn;
+            T* dst = r + k * bn;
+            T carry = limb_add_n(dst, dst, odd.data() + k / 2 * 2 * bn, len);
+            limb_add_1(dst + len, dst + len, an + bn - k * bn - len, carry);
+        }
+    }
+}
+
+
+void limb_mul(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b, size_t bn) {
+    mul_(r, a, an, b, bn);
+}
+
+
+void limb_mul(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn) {
+    mul_(r, a, an, b, bn);
+}
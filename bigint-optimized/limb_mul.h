@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Умножение длинных чисел над отрезками цифр в духе limb_ops.h. Пока
+ * меньший множитель короче karatsuba_min_limbs выбранного набора ядер
+ * (см. limb_kernels.h), работает его mul_basecase, дальше -- рекурсия
+ * Карацубы (вычитательный вариант: среднее слагаемое -- z0 + z2 -
+ * (a0 - a1)(b0 - b1), без переносов в суммах половин). Неравные множители
+ * режутся на куски длины меньшего.
+ *
+ * Если задано больше одного потока (см. set_bigint_threads в
+ * thread_pool.h), три подпроизведения уровней с меньшим множителем от
+ * PARALLEL_MUL_MIN_LIMBS цифр и куски неравных множителей считаются в
+ * пуле. Результат от числа потоков не зависит
+ */
+
+// для 32-битных цифр ядро одно, встроенное
+const size_t KARATSUBA_MIN_LIMBS_32 = 32;
+const size_t PARALLEL_MUL_MIN_LIMBS = 2048;
+
+// r[0, an + bn) = a[0, an) * b[0, bn); an, bn >= 1, r не пересекается с a и b
+void limb_mul(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b, size_t bn);
+void limb_mul(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn);
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "limb_dispatch.h"
+#include "limb_kernels.h"
+#include "limb_traits.h"
+
+/*
+ * Низкоуровневый слой в духе mpn из GMP: функции над отрезками цифр
+ * (указатель и длина), младшие цифры первыми. Они не выделяют память и не
+ * нормализуют результат, поэтому годятся для арифметики над частями
+ * чужих буферов, а операторы big_integer построены поверх них.
+ *
+ * Все имена начинаются с limb_, чтобы не сталкиваться с функциями
+ * пользователя: limb_add_n, limb_sub_n, limb_mul_1 и limb_addmul_1 -- ядра
+ * из limb_dispatch.h (uint64_t) и limb_kernels.h (uint32_t), остальное
+ * здесь. Все функции есть для цифр uint64_t и uint32_t. Если не сказано
+ * иначе, длины n >= 1.
+ *
+ * Операции двойной ширины в limb_submul_1 и limb_divrem_1 берутся из политики цифры
+ * (см. limb_traits.h); big_integer передаёт свою, по умолчанию для x86-64
+ * это limb64_asm_traits, если BIGINT_LIMB_TRAITS не запрещает ассемблер
+ */
+
+template <typename T>
+struct limb_ops_traits_;
+
+template <>
+struct limb_ops_traits_<uint32_t> {
+    using type = limb32_traits;
+};
+
+template <>
+struct limb_ops_traits_<uint64_t> {
+#if defined(__x86_64__)
+    using type = std::conditional<BIGINT_LIMB_TRAITS::NATIVE_KERNELS, limb64_asm_traits, limb64_int128_traits>::type;
+#else
+    using type = limb64_int128_traits;
+#endif
+};
+
+// r[0, n) = a[0, n) + b, возвращает перенос; n >= 0, r может совпадать с a
+template <typename T>
+T limb_add_1(T* r, const T* a, size_t n, T b) {
+    for (size_t i = 0; i < n; i++) {
+        r[i] = a[i] + b;
+        if (r[i] >= b) {
+            if (r != a) {
+                std::memcpy(r + i + 1, a + i + 1, (n - i - 1) * sizeof(T));
+            }
+            return 0;
+        }
+        b = 1;
+    }
+    return b;
+}
+
+// r[0, n) = a[0, n) - b, возвращает заём; n >= 0, r может совпадать с a
+template <typename T>
+T limb_sub_1(T* r, const T* a, size_t n, T b) {
+    for (size_t i = 0; i < n; i++) {
+        T digit = a[i];
+        r[i] = digit - b;
+        if (digit >= b) {
+            if (r != a) {
+                std::memcpy(r + i + 1, a + i + 1, (n - i - 1) * sizeof(T));
+            }
+            return 0;
+        }
+        b = 1;
+    }
+    return b;
+}
+
+// r[0, n) -= a[0, n) * b, возвращает заём из старшей цифры
+template <typename T, typename Traits = typename limb_ops_traits_<T>::type>
+T limb_submul_1(T* r, const T* a, size_t n, T b) {
+    T carry = 0;
+    for (size_t i = 0; i < n; i++) {
+        T lower = a[i] * b;
+        T upper = Traits::mul_high(a[i], b);
+        lower += carry;
+        upper += lower < carry;
+        T digit = r[i] - lower;
+        upper += digit > r[i];
+        r[i] = digit;
+        carry = upper;
+    }
+    return carry;
+}
+
+/*
+ * r[0, n) = a[0, n) << shift, 0 <= shift < разрядности цифры; возвращает
+ * выдвинутые старшие биты. Цифры обходятся сверху вниз, поэтому r может
+ * совпадать с a или лежать выше неё (сдвиг внутри одного буфера)
+ */
+template <typename T>
+T limb_lshift(T* r, const T* a, size_t n, unsigned shift) {
+    const unsigned BITS = 8 * sizeof(T);
+    if (shift == 0) {
+        std::memmove(r, a, n * sizeof(T));
+        return 0;
+    }
+    T out = a[n - 1] >> (BITS - shift);
+    for (size_t i = n; i --> 1; ) {
+        r[i] = a[i] << shift | a[i - 1] >> (BITS - shift);
+    }
+    r[0] = a[0] << shift;
+    return out;
+}
+
+/*
+ * r[0, n) = a[0, n) >> shift, 0 <= shift < разрядности цифры; возвращает
+ * выдвинутые младшие биты в старших разрядах цифры. Цифры обходятся снизу
+ * вверх, поэтому r может совпадать с a или лежать ниже неё
+ */
+template <typename T>
+T limb_rshift(T* r, const T* a, size_t n, unsigned shift) {
+    const unsigned BITS = 8 * sizeof(T);
+    if (shift == 0) {
+        std::memmove(r, a, n * sizeof(T));
+        return 0;
+    }
+    T out = a[0] << (BITS - shift);
+    for (size_t i = 0; i + 1 < n; i++) {
+        r[i] = a[i] >> shift | a[i + 1] << (BITS - shift);
+    }
+    r[n - 1] = a[n - 1] >> shift;
+    return out;
+}
+
+// q[0, n) = a[0, n) / d, возвращает остаток; d != 0, q может совпадать с a
+template <typename T, typename Traits = typename limb_ops_traits_<T>::type>
+T limb_divrem_1(T* q, const T* a, size_t n, T d) {
+    T rem = 0;
+    for (size_t i = n; i --> 0; ) {
+        std::pair<T, T> qr = Traits::div_mod(rem, a[i], d);
+        q[i] = qr.first;
+        rem = qr.second;
+    }
+    return rem;
+}
+
+// знак a[0, n) - b[0, n): -1, 0 или 1; n >= 0
+template <typename T>
+int limb_cmp(const T* a, const T* b, size_t n) {
+    for (size_t i = n; i --> 0; ) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
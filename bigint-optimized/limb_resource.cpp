@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include "limb_resource.h"
+
+namespace {
+    struct new_delete_resource_ : limb_memory_resource {
+        void* allocate(size_t bytes, size_t) override {
+            return ::operator new(bytes);
+        }
+
+        void deallocate(void* ptr, size_t, size_t) override {
+            ::operator delete(ptr);
+        }
+    };
+
+    const size_t MIN_CLASS_POWER = 4;
+    const size_t CLASS_COUNT = 17;  // 2^4 .. 2^20 байт
+
+    struct free_block_ {
+        free_block_* next;
+    };
+
+    size_t class_bytes_(size_t c) {
+        return size_t(1) << (c + MIN_CLASS_POWER);
+    }
+
+    struct pool_state_ {
+        free_block_* heads[CLASS_COUNT];
+        size_t counts[CLASS_COUNT];
+        size_t capacity;
+        size_t max_bytes;
+        limb_pool_stats stats;
+
+        pool_state_()
+                : heads(), counts(), capacity(LIMB_POOL_DEFAULT_CAPACITY),
+                  max_bytes(LIMB_POOL_DEFAULT_MAX_BYTES), stats() { }
+
+        ~pool_state_();
+
+        void pop(size_t c) {
+            free_block_* block = heads[c];
+            heads[c] = block->next;
+            --counts[c];
+            --stats.cached;
+            stats.cached_bytes -= class_bytes_(c);
+            ::operator delete(block);
+        }
+
+        // сначала выбрасываются крупные блоки: они держат больше всего памяти
+        void shrink() {
+            for (size_t c = CLASS_COUNT; c --> 0;) {
+                while (counts[c] > capacity || (counts[c] > 0 && stats.cached_bytes > max_bytes)) {
+                    pop(c);
+                }
+            }
+        }
+
+        void trim() {
+            for (size_t c = 0; c < CLASS_COUNT; c++) {
+                while (heads[c] != nullptr) {
+                    pop(c);
+                }
+            }
+        }
+    };
+
+    thread_local pool_state_ pool_;
+    // thread_local-объекты, разрушаемые после пула, возвращают память напрямую
+    thread_local bool pool_dead_ = false;
+
+    pool_state_::~pool_state_() {
+        trim();
+        pool_dead_ = true;
+    }
+
+    size_t size_class_(size_t bytes) {
+        size_t c = 0;
+        while ((size_t(1) << (c + MIN_CLASS_POWER)) < bytes) {
+            c++;
+        }
+        return c;
+    }
+
+    bool pooled_(size_t bytes, size_t align) {
+        return bytes <= LIMB_POOL_MAX_BLOCK && align <= alignof(std::max_align_t);
+    }
+
+    struct pool_resource_ : limb_memory_resource {
+        size_t usable_size(size_t bytes, size_t align) const override {
+            return pooled_(bytes, align) ? class_bytes_(size_class_(bytes)) : bytes;
+        }
+
+        void* allocate(size_t bytes, size_t align) override {
+            if (!pooled_(bytes, align) || pool_dead_) {
+                return ::operator new(bytes);
+            }
+            size_t c = size_class_(bytes);
+            if (pool_.heads[c] != nullptr) {
+                free_block_* block = pool_.heads[c];
+                pool_.heads[c] = block->next;
+                --pool_.counts[c];
+                --pool_.stats.cached;
+                pool_.stats.cached_bytes -= class_bytes_(c);
+                ++pool_.stats.hits;
+                return block;
+            }
+            ++pool_.stats.misses;
+            return ::operator new(class_bytes_(c));
+        }
+
+        void deallocate(void* ptr, size_t bytes, size_t align) override {
+            if (!pooled_(bytes, align) || pool_dead_) {
+                ::operator delete(ptr);
+                return;
+            }
+            size_t c = size_class_(bytes);
+            if (pool_.counts[c] >= pool_.capacity
+                || pool_.stats.cached_bytes + class_bytes_(c) > pool_.max_bytes) {
+                ::operator delete(ptr);
+                return;
+            }
+            auto* block = static_cast<free_block_*>(ptr);
+            block->next = pool_.heads[c];
+            pool_.heads[c] = block;
+            ++pool_.counts[c];
+            ++pool_.stats.cached;
+            pool_.stats.cached_bytes += class_bytes_(c);
+        }
+    };
+
+    thread_local limb_memory_resource* current_resource_ = nullptr;
+
+    /*
+     * Источники по умолчанию никогда не разрушаются: глобальное число, созданное
+     * раньше первого обращения к источнику, разрушается позже него и всё равно
+     * возвращает ему свой блок
+     */
+    template <typename Resource>
+    limb_memory_resource* immortal_resource_() {
+        static typename std::aligned_storage<sizeof(Resource), alignof(Resource)>::type storage;
+        static limb_memory_resource* instance = new (&storage) Resource();
+        return instance;
+    }
+}
+
+limb_memory_resource* new_delete_limb_resource() {
+    return immortal_resource_<new_delete_resource_>();
+}
+
+
+limb_memory_resource* limb_pool_resource() {
+    return immortal_resource_<pool_resource_>();
+}
+
+
+limb_pool_stats get_limb_pool_stats() {
+    return pool_.stats;
+}
+
+
+void reset_limb_pool_stats() {
+    pool_.stats.hits = pool_.stats.misses = 0;
+}
+
+
+void set_limb_pool_capacity(size_t blocks_per_class) {
+    pool_.capacity = blocks_per_class;
+    pool_.shrink();
+}
+
+
+void set_limb_pool_max_bytes(size_t max_bytes) {
+    pool_.max_bytes = max_bytes;
+    pool_.shrink();
+}
+
+
+void trim_limb_pool() {
+    pool_.trim();
+}
+
+
+limb_memory_resource* get_limb_resource() {
+    return current_resource_ != nullptr ? current_resource_ : limb_pool_resource();
+}
+
+
+limb_memory_resource* set_limb_resource(limb_memory_resource* resource) {
+    limb_memory_resource* prev = get_limb_resource();
+    current_resource_ = resource;
+    return prev;
+}
+
+
+monotonic_limb_arena::monotonic_limb_arena(size_t initial_size, limb_memory_resource* upstream)
+        : upstream_(upstream), chunks_(nullptr), cur_(nullptr), end_(nullptr),
+          next_size_(std::max<size_t>(initial_size, 64)), allocated_(0) { }
+
+
+monotonic_limb_arena::~monotonic_limb_arena() {
+    release();
+}
+
+
+void* monotonic_limb_arena::allocate(size_t bytes, size_t align) {
+    uintptr_t cur = reinterpret_cast<uintptr_t>(cur_);
+    uintptr_t aligned = (cur + align - 1) / align * align;
+    if (cur_ == nullptr || aligned + bytes > reinterpret_cast<uintptr_t>(end_)) {
+        size_t size = std::max(next_size_, bytes + align + sizeof(chunk_));
+        auto* chunk = static_cast<chunk_*>(upstream_->allocate(size, alignof(chunk_)));
+        chunk->next = chunks_;
+        chunk->size = size;
+        chunks_ = chunk;
+        cur_ = reinterpret_cast<char*>(chunk + 1);
+        end_ = reinterpret_cast<char*>(chunk) + size;
+        next_size_ = size * 2;
+        cur = reinterpret_cast<uintptr_t>(cur_);
+        aligned = (cur + align - 1) / align * align;
+    }
+    cur_ = reinterpret_cast<char*>(aligned + bytes);
+    allocated_ += bytes;
+    return reinterpret_cast<void*>(aligned);
+}
+
+
+void monotonic_limb_arena::release() {
+    while (chunks_ != nullptr) {
+        chunk_* next = chunks_->next;
+        upstream_->deallocate(chunks_, chunks_->size, alignof(chunk_));
+        chunks_ = next;
+    }
+    cur_ = end_ = nullptr;
+    allocated_ = 0;
+}
+
+
+size_t monotonic_limb_arena::bytes_allocated() const {
+    return allocated_;
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+/*
+ * Источник памяти для буферов цифр (по образцу std::pmr::memory_resource).
+ * Буферы берутся из текущего источника потока в момент создания и
+ * возвращаются тому же источнику, из которого были получены
+ */
+
+struct limb_memory_resource {
+    virtual ~limb_memory_resource() = default;
+    virtual void* allocate(size_t bytes, size_t align) = 0;
+    virtual void deallocate(void* ptr, size_t bytes, size_t align) = 0;
+
+    // сколько байт на самом деле выдаст allocate(bytes, align); блок можно
+    // запросить и вернуть под этим размером, не переходя в другой класс
+    virtual size_t usable_size(size_t bytes, size_t) const {
+        return bytes;
+    }
+};
+
+// operator new / operator delete без кэширования
+limb_memory_resource* new_delete_limb_resource();
+
+/*
+ * Пул блоков с размерами-степенями двойки поверх operator new, используется
+ * по умолчанию. Списки свободных блоков у каждого потока свои: освобождённый
+ * буфер попадает в пул потока, который его освободил, и выдаётся повторно без
+ * обращения к malloc. Блоки больше LIMB_POOL_MAX_BLOCK идут мимо пула
+ */
+limb_memory_resource* limb_pool_resource();
+
+const size_t LIMB_POOL_MAX_BLOCK = size_t(1) << 20;
+
+struct limb_pool_stats {
+    size_t hits;      // выдано из пула
+    size_t misses;    // выделено через operator new
+    size_t cached;    // блоков сейчас лежит в пуле
+    size_t cached_bytes;
+};
+
+const size_t LIMB_POOL_DEFAULT_CAPACITY = 32;
+const size_t LIMB_POOL_DEFAULT_MAX_BYTES = size_t(4) << 20;
+
+// статистика и настройки относятся к пулу текущего потока
+limb_pool_stats get_limb_pool_stats();
+void reset_limb_pool_stats();
+
+/*
+ * Пул потока удерживает не больше blocks_per_class свободных блоков каждого
+ * размера и не больше max_bytes байт в сумме (по умолчанию 32 блока и 4 МиБ).
+ * Освобождённый блок, не влезающий в лимиты, сразу отдаётся operator delete,
+ * так что простаивающий поток, в том числе рабочий поток пула задач,
+ * держит не больше max_bytes памяти под кэш. Уменьшение лимитов сразу
+ * освобождает лишнее, начиная с крупных блоков
+ */
+void set_limb_pool_capacity(size_t blocks_per_class);
+void set_limb_pool_max_bytes(size_t max_bytes);
+void trim_limb_pool();
+
+limb_memory_resource* get_limb_resource();
+
+// возвращает предыдущий источник текущего потока
+limb_memory_resource* set_limb_resource(limb_memory_resource*);
+
+// подменяет источник текущего потока на время жизни объекта
+struct limb_resource_scope {
+    explicit limb_resource_scope(limb_memory_resource* resource)
+            : prev_(set_limb_resource(resource)) { }
+
+    limb_resource_scope(const limb_resource_scope&) = delete;
+    limb_resource_scope& operator=(const limb_resource_scope&) = delete;
+
+    ~limb_resource_scope() {
+        set_limb_resource(prev_);
+    }
+
+ private:
+    limb_memory_resource* prev_;
+};
+
+/*
+ * Арена: выделение сдвигом указателя, deallocate ничего не делает,
+ * вся память освобождается разом в release() или деструкторе.
+ * Числа, созданные в арене, не должны её переживать
+ */
+class monotonic_limb_arena : public limb_memory_resource {
+ public:
+    explicit monotonic_limb_arena(size_t initial_size = 4096,
+                                  limb_memory_resource* upstream = new_delete_limb_resource());
+    monotonic_limb_arena(const monotonic_limb_arena&) = delete;
+    monotonic_limb_arena& operator=(const monotonic_limb_arena&) = delete;
+    ~monotonic_limb_arena() override;
+
+    void* allocate(size_t bytes, size_t align) override;
+    void deallocate(void*, size_t, size_t) override { }
+
+    void release();
+    size_t bytes_allocated() const;
+
+ private:
+    struct chunk_ {
+        chunk_* next;
+        size_t size;
+    };
+
+    limb_memory_resource* upstream_;
+    chunk_* chunks_;
+    char* cur_;
+    char* end_;
+    size_t next_size_;
+    size_t allocated_;
+};
+
+// stateful-аллокатор поверх limb_memory_resource для стандартных контейнеров
+template <typename T>
+struct limb_allocator {
+    using value_type = T;
+
+    limb_allocator()
+            : resource_(get_limb_resource()) { }
+
+    explicit limb_allocator(limb_memory_resource* resource)
+            : resource_(resource) { }
+
+    template <typename U>
+    limb_allocator(const limb_allocator<U>& other)
+            : resource_(other.resource()) { }
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) {
+        resource_->deallocate(ptr, n * sizeof(T), alignof(T));
+    }
+
+    limb_memory_resource* resource() const {
+        return resource_;
+    }
+
+ private:
+    limb_memory_resource* resource_;
+};
+
+template <typename T, typename U>
+bool operator==(const limb_allocator<T>& left, const limb_allocator<U>& right) {
+    return left.resource() == right.resource();
+}
+
+template <typename T, typename U>
+bool operator!=(const limb_allocator<T>& left, const limb_allocator<U>& right) {
+    return !(left == right);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+/*
+ * Политики цифры big_integer: тип цифры, наибольшая степень 10,
+ * помещающаяся в цифру, и операции двойной ширины -- старшая
+ * половина произведения и деление двузначного числа на цифру.
+ *
+ * Политика выбирается при сборке макросом BIGINT_LIMB_TRAITS,
+ * по умолчанию limb64_asm_traits на x86-64.
+ *
+ * NATIVE_KERNELS разрешает остальной библиотеке ассемблер для цифр
+ * uint64_t: ядра, которые limb_dispatch выбирает по cpuid, и mulq/divq
+ * в limb_ops.h. При false используются только переносимые ядра
+ */
+
+// mulq/divq через ассемблерные вставки, только x86-64
+struct limb64_asm_traits {
+    using limb_t = uint64_t;
+
+    static const bool NATIVE_KERNELS = true;
+
+    static const size_t DIGITS_COUNT = 19;  // 19 -- max power of 10 less than 2^64
+    static const limb_t POWER_10_DIGITS = 10000000000000000000ULL;
+
+    static limb_t mul_high(limb_t left, limb_t right) {
+        limb_t upper, lower;
+        __asm__("mulq %3;"
+        : "=a" (lower), "=d" (upper)
+        : "a" (left), "r" (right));
+        return upper;
+    }
+
+    // if upper_left >= right || right == 0 then UB
+    static std::pair<limb_t, limb_t> div_mod(limb_t upper_left, limb_t lower_left, limb_t right) {
+        limb_t result, modulo;
+        __asm__("divq %4;"
+        : "=a" (result), "=d" (modulo)
+        : "a" (lower_left), "d" (upper_left), "r" (right));
+        return {result, modulo};
+    }
+};
+
+// переносимый вариант: компилятор сам выбирает инструкции для unsigned __int128
+struct limb64_int128_traits {
+    using limb_t = uint64_t;
+    __extension__ typedef unsigned __int128 double_limb_t;
+
+    static const bool NATIVE_KERNELS = false;
+
+    static const size_t DIGITS_COUNT = 19;
+    static const limb_t POWER_10_DIGITS = 10000000000000000000ULL;
+
+    static limb_t mul_high(limb_t left, limb_t right) {
+        return static_cast<limb_t>(static_cast<double_limb_t>(left) * right >> 64);
+    }
+
+    static std::pair<limb_t, limb_t> div_mod(limb_t upper_left, limb_t lower_left, limb_t right) {
+        double_limb_t left = static_cast<double_limb_t>(upper_left) << 64 | lower_left;
+        return {static_cast<limb_t>(left / right), static_cast<limb_t>(left % right)};
+    }
+};
+
+// 32-битные цифры, двойная ширина -- uint64_t
+struct limb32_traits {
+    using limb_t = uint32_t;
+
+    static const bool NATIVE_KERNELS = true;
+
+    static const size_t DIGITS_COUNT = 9;  // 9 -- max power of 10 less than 2^32
+    static const limb_t POWER_10_DIGITS = 1000000000U;
+
+    static limb_t mul_high(limb_t left, limb_t right) {
+        return static_cast<limb_t>(static_cast<uint64_t>(left) * right >> 32);
+    }
+
+    static std::pair<limb_t, limb_t> div_mod(limb_t upper_left, limb_t lower_left, limb_t right) {
+        uint64_t left = static_cast<uint64_t>(upper_left) << 32 | lower_left;
+        return {static_cast<limb_t>(left / right), static_cast<limb_t>(left % right)};
+    }
+};
+
+#ifndef BIGINT_LIMB_TRAITS
+#if defined(__x86_64__)
+#define BIGINT_LIMB_TRAITS limb64_asm_traits
+#else
+#define BIGINT_LIMB_TRAITS limb64_int128_traits
+#endif
+#endif
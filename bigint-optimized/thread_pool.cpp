@@ -0,0 +1,201 @@
+#include "thread_pool.h"
+
+namespace {
+    // пул и номер очереди текущего рабочего потока
+    thread_local const thread_pool* worker_pool_ = nullptr;
+    thread_local size_t worker_index_ = 0;
+
+    std::mutex config_mutex_;
+    std::unique_ptr<thread_pool> global_pool_;
+    std::atomic<thread_pool*> global_pool_ptr_(nullptr);
+    size_t global_threads_ = 1;
+
+    // сколько раз подряд ожидающий поток не находит задач, прежде чем уснуть
+    const size_t WAIT_SPINS = 64;
+}
+
+
+thread_pool::thread_pool(size_t threads)
+        : stop_(false), queued_(0) {
+    size_t count = threads == 0 ? 1 : threads;
+    for (size_t i = 0; i < count; i++) {
+        queues_.emplace_back(new queue_());
+    }
+    for (size_t i = 1; i < count; i++) {
+        threads_.emplace_back(&thread_pool::worker_loop_, this, i);
+    }
+}
+
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& t : threads_) {
+        t.join();
+    }
+}
+
+
+size_t thread_pool::own_queue_() const {
+    return worker_pool_ == this ? worker_index_ : 0;
+}
+
+
+void thread_pool::push_(task_ task) {
+    queue_& q = *queues_[own_queue_()];
+    {
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        ++queued_;
+    }
+    wake_.notify_one();
+}
+
+
+// своя очередь -- с конца (последняя порождённая задача), чужие -- с начала
+bool thread_pool::run_one_() {
+    size_t self = own_queue_(), count = queues_.size();
+    task_ task;
+    bool found = false;
+    for (size_t k = 0; k < count && !found; k++) {
+        queue_& q = *queues_[(self + k) % count];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty()) {
+            if (k == 0) {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+            } else {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+            }
+            found = true;
+        }
+    }
+    if (!found) {
+        return false;
+    }
+    --queued_;
+    std::exception_ptr error;
+    try {
+        task.fn();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    task.group->finish_(error);
+    return true;
+}
+
+
+void thread_pool::worker_loop_(size_t index) {
+    worker_pool_ = this;
+    worker_index_ = index;
+    while (true) {
+        if (run_one_()) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        // push_ увеличивает queued_ под sleep_mutex_, так что пробуждение не теряется
+        wake_.wait(lock, [this] { return stop_ || queued_ != 0; });
+        if (stop_) {
+            return;
+        }
+    }
+}
+
+
+thread_pool::task_group::~task_group() {
+    // задачи ссылаются на группу, поэтому она не разрушается раньше них
+    wait_pending_();
+}
+
+
+void thread_pool::task_group::run(std::function<void()> task) {
+    if (pool_ == nullptr) {
+        try {
+            task();
+        } catch (...) {
+            record_error_(std::current_exception());
+        }
+        return;
+    }
+    ++pending_;
+    pool_->push_(task_{std::move(task), this});
+}
+
+
+void thread_pool::task_group::record_error_(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    if (!error_) {
+        error_ = error;
+    }
+}
+
+
+void thread_pool::task_group::finish_(std::exception_ptr error) {
+    if (error) {
+        record_error_(error);
+    }
+    // под мьютексом: ожидающий поток не разрушит группу, пока notify не вернулся
+    std::lock_guard<std::mutex> lock(done_mutex_);
+    if (--pending_ == 0) {
+        done_.notify_all();
+    }
+}
+
+
+void thread_pool::task_group::wait_pending_() {
+    if (pool_ == nullptr) {
+        return;
+    }
+    for (size_t spins = 0; pending_ != 0 && spins < WAIT_SPINS;) {
+        if (pool_->run_one_()) {
+            spins = 0;
+        } else {
+            ++spins;
+            std::this_thread::yield();
+        }
+    }
+    // очереди пусты, а оставшиеся задачи группы выполняются в других потоках
+    std::unique_lock<std::mutex> lock(done_mutex_);
+    done_.wait(lock, [this] { return pending_ == 0; });
+}
+
+
+void thread_pool::task_group::wait() {
+    wait_pending_();
+    if (error_) {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+
+void set_bigint_threads(size_t threads) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    threads = threads == 0 ? 1 : threads;
+    if (threads == global_threads_) {
+        return;
+    }
+    global_pool_ptr_ = nullptr;
+    global_pool_.reset(threads > 1 ? new thread_pool(threads) : nullptr);
+    global_pool_ptr_ = global_pool_.get();
+    global_threads_ = threads;
+}
+
+
+size_t get_bigint_threads() {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    return global_threads_;
+}
+
+
+thread_pool* bigint_thread_pool() {
+    return global_pool_ptr_.load(std::memory_order_acquire);
+}
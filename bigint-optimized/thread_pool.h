@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Пул потоков с перехватом задач для параллельных алгоритмов над цифрами
+ * (умножение больших чисел, перевод в строку).
+ *
+ * У каждого рабочего потока своя очередь: новые задачи кладутся в очередь
+ * того потока, который их породил, и берутся оттуда с того же конца, а
+ * простаивающие потоки забирают задачи с противоположного конца чужих
+ * очередей. Поток, ждущий свою группу задач, тоже выполняет задачи, так
+ * что вложенные группы не блокируют пул
+ */
+class thread_pool {
+ public:
+    // threads - 1 рабочих потоков; вызывающий поток считается ещё одним
+    explicit thread_pool(size_t threads);
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+    ~thread_pool();
+
+    size_t size() const {
+        return queues_.size();
+    }
+
+    /*
+     * Группа задач с общим ожиданием. С pool == nullptr run() выполняет
+     * задачу сразу в вызывающем потоке. Первое исключение из задач группы
+     * перебрасывается из wait(). Ожидающий поток выполняет задачи из
+     * очередей пула, а когда их нет, засыпает до завершения группы
+     */
+    class task_group {
+     public:
+        explicit task_group(thread_pool* pool)
+                : pool_(pool), pending_(0) { }
+
+        task_group(const task_group&) = delete;
+        task_group& operator=(const task_group&) = delete;
+
+        ~task_group();
+
+        void run(std::function<void()> task);
+        void wait();
+
+     private:
+        friend class thread_pool;
+
+        void record_error_(std::exception_ptr error);
+        void finish_(std::exception_ptr error);
+        void wait_pending_();
+
+        thread_pool* pool_;
+        std::atomic<size_t> pending_;
+        std::mutex done_mutex_;
+        std::condition_variable done_;
+        std::mutex error_mutex_;
+        std::exception_ptr error_;
+    };
+
+ private:
+    struct task_ {
+        std::function<void()> fn;
+        task_group* group;
+    };
+
+    struct queue_ {
+        std::mutex mutex;
+        std::deque<task_> tasks;
+    };
+
+    void push_(task_ task);
+    bool run_one_();
+    void worker_loop_(size_t index);
+    size_t own_queue_() const;
+
+    // queues_[0] -- очередь потоков вне пула, queues_[i] -- рабочего потока i
+    std::vector<std::unique_ptr<queue_>> queues_;
+    std::vector<std::thread> threads_;
+    std::atomic<bool> stop_;
+    std::atomic<size_t> queued_;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+};
+
+/*
+ * Число потоков для параллельных алгоритмов big_integer. По умолчанию 1:
+ * пул не создаётся, и всё считается в вызывающем потоке в том же порядке,
+ * что и без поддержки потоков. Менять, пока идут вычисления, нельзя
+ */
+void set_bigint_threads(size_t threads);
+size_t get_bigint_threads();
+
+// nullptr, если потоков 1
+thread_pool* bigint_thread_pool();
@@ -4,31 +4,64 @@
 #pragma once
 
 #include <memory>
+#include <utility>
 #include <vector>
 #include <iostream>
 #include <algorithm>
+#include <cstring>
 #include "vector_ptr.h"
 
-template <typename T, typename = void>
+/*
+ * Цифры числа: до InlineSize штук хранятся прямо в объекте, больше -- в
+ * разделяемом буфере vector_ptr. Размер маленького числа и флаг is_big_
+ * занимают одно машинное слово перед буфером
+ */
+template <typename T, size_t InlineSize, typename = void>
 struct uint_storage;
 
-template <typename T>
-struct uint_storage<T, typename std::enable_if<std::is_unsigned<T>::value>::type> {
+template <typename T, size_t InlineSize>
+struct uint_storage<T, InlineSize, typename std::enable_if<std::is_unsigned<T>::value>::type> {
+    static_assert(InlineSize >= 1 && InlineSize <= 255, "small size is stored in one byte");
+
     using iterator = T*;
     using const_iterator = const T*;
 
     uint_storage() {
         is_big_ = false;
         size_ = 0;
+        std::fill(small_data_, small_data_ + SMALL_DATA_SIZE, T());
     }
 
-    uint_storage(size_t sz, const T& elem) : uint_storage() {
-        while (sz--) {
-            push_back(elem);
+    uint_storage(size_t sz, const T& elem) {
+        is_big_ = sz > SMALL_DATA_SIZE;
+        if (is_big_) {
+            new (&big_data_) vector_ptr<T>(sz, elem);
+        } else {
+            std::fill(small_data_, small_data_ + sz, elem);
+            std::fill(small_data_ + sz, small_data_ + SMALL_DATA_SIZE, T());
+            size_ = static_cast<unsigned char>(sz);
         }
     }
 
-    uint_storage(const uint_storage<T>& other) {
+    uint_storage(const_iterator first, const_iterator last) {
+        is_big_ = static_cast<size_t>(last - first) > SMALL_DATA_SIZE;
+        if (is_big_) {
+            new (&big_data_) vector_ptr<T>(first, last);
+        } else {
+            std::fill(std::copy(first, last, small_data_), small_data_ + SMALL_DATA_SIZE, T());
+            size_ = static_cast<unsigned char>(last - first);
+        }
+    }
+
+    // хранилище, ссылающееся на чужие данные только для чтения; см. vector_ptr
+    static uint_storage view(const T* data, size_t size, std::shared_ptr<const void> owner) {
+        uint_storage result;
+        new (&result.big_data_) vector_ptr<T>(data, size, std::move(owner));
+        result.is_big_ = true;
+        return result;
+    }
+
+    uint_storage(const uint_storage& other) {
         if (other.is_big_) {
             init_big_data(other);
         } else {
@@ -37,7 +70,7 @@ struct uint_storage<T, typename std::enable_if<std::is_unsigned<T>::value>::type
         is_big_ = other.is_big_;
     }
 
-    uint_storage& operator=(const uint_storage<T>& other) {
+    uint_storage& operator=(const uint_storage& other) {
         if (this == &other) {
             return (*this);
         }
@@ -64,16 +97,16 @@ struct uint_storage<T, typename std::enable_if<std::is_unsigned<T>::value>::type
     }
 
     size_t size() const {
-        return is_big_ ? big_data_->size() : size_;
+        return is_big_ ? big_data_.size() : size_;
     }
 
     void push_back(const T& elem) {
         if (!is_big_ && size_ == SMALL_DATA_SIZE) {
-            small_to_big();
+            small_to_big(2 * SMALL_DATA_SIZE);
         }
         if (is_big_) {
             big_data_.detach();
-            big_data_->push_back(elem);
+            big_data_.push_back(elem);
         } else {
             small_data_[size_++] = elem;
         }
@@ -82,7 +115,7 @@ struct uint_storage<T, typename std::enable_if<std::is_unsigned<T>::value>::type
     void pop_back() {
         if (is_big_) {
             big_data_.detach();
-            big_data_->pop_back();
+            big_data_.pop_back();
         } else {
             --size_;
         }
@@ -91,44 +124,79 @@ struct uint_storage<T, typename std::enable_if<std::is_unsigned<T>::value>::type
     T& operator[](size_t ind) {
         if (is_big_) {
             big_data_.detach();
-            return (*big_data_)[ind];
+            return big_data_.mutable_data()[ind];
         }
         return small_data_[ind];
     }
 
     const T& operator[](size_t ind) const {
-        return is_big_ ? (*big_data_)[ind] : small_data_[ind];
+        return is_big_ ? big_data_.data()[ind] : small_data_[ind];
     }
 
     void resize(size_t new_size) {
-        if (!is_big_ && new_size > SMALL_DATA_SIZE) {
-            small_to_big();
+        if (is_big_) {
+            big_data_.detach();
+            big_data_.resize(new_size);
+        } else if (new_size > SMALL_DATA_SIZE) {
+            small_to_big(new_size);
+            big_data_.resize(new_size);
+        } else {
+            if (new_size > size_) {
+                std::fill(small_data_ + size_, small_data_ + new_size, 0);
+            }
+            size_ = static_cast<unsigned char>(new_size);
+        }
+    }
+
+    void assign(const_iterator first, const_iterator last) {
+        (*this) = uint_storage(first, last);
+    }
+
+    size_t capacity() const {
+        return is_big_ ? big_data_.capacity() : SMALL_DATA_SIZE;
+    }
+
+    void reserve(size_t new_capacity) {
+        if (new_capacity <= capacity()) {
+            return;
         }
         if (is_big_) {
             big_data_.detach();
-            big_data_->resize(new_size);
+            big_data_.reserve(new_capacity);
         } else {
-            std::fill(small_data_ + size_, small_data_ + new_size, 0);
-            size_ = new_size;
+            small_to_big(new_capacity);
+        }
+    }
+
+    // лишняя ёмкость освобождается, только если буфер ни с кем не разделён
+    void shrink_to_fit() {
+        if (!is_big_ || big_data_.capacity() == big_data_.size()) {
+            return;
+        }
+        if (big_data_.size() <= SMALL_DATA_SIZE) {
+            big_to_small();
+        } else {
+            big_data_.detach();
+            big_data_.shrink_to_fit();
         }
     }
 
     T& back() {
         if (is_big_) {
             big_data_.detach();
-            return big_data_->back();
+            return big_data_.mutable_data()[big_data_.size() - 1];
         }
         return small_data_[size_ - 1];
     }
 
     const T& back() const {
-        return is_big_ ? big_data_->back() : small_data_[size_ - 1];
+        return is_big_ ? big_data_.data()[big_data_.size() - 1] : small_data_[size_ - 1];
     }
 
     iterator begin() {
         if (is_big_) {
             big_data_.detach();
-            return big_data_->data();
+            return big_data_.mutable_data();
         }
         return small_data_;
     }
@@ -136,40 +204,102 @@ struct uint_storage<T, typename std::enable_if<std::is_unsigned<T>::value>::type
     iterator end() {
         if (is_big_) {
             big_data_.detach();
-            return big_data_->data() + big_data_->size();
+            return big_data_.mutable_data() + big_data_.size();
         }
         return small_data_ + size_;
     }
 
     const_iterator begin() const {
-        return is_big_ ? big_data_->data() : small_data_;
+        return is_big_ ? big_data_.data() : small_data_;
     }
 
     const_iterator end() const {
-        return is_big_ ? big_data_->data() + big_data_->size() : small_data_ + size_;
+        return is_big_ ? big_data_.data() + big_data_.size() : small_data_ + size_;
+    }
+
+    const_iterator cbegin() const {
+        return begin();
+    }
+
+    const_iterator cend() const {
+        return end();
+    }
+
+    /*
+     * Отделяет общий буфер один раз и возвращает указатель на цифры.
+     * Указатель действителен до следующего изменения размера, и запись через
+     * него не проверяет счётчик ссылок -- для внутренних циклов по цифрам
+     */
+    T* make_unique() {
+        if (is_big_) {
+            big_data_.detach();
+            return big_data_.mutable_data();
+        }
+        return small_data_;
+    }
+
+    std::pair<T*, size_t> mutable_span() {
+        T* data = make_unique();
+        return {data, size()};
+    }
+
+    // хэш по цифрам; с BIGINT_ATOMIC_REFCOUNT для данных в куче кэшируется в общем блоке vector_ptr
+    size_t hash() const {
+        size_t result;
+        if (is_big_ && big_data_.cached_hash(result)) {
+            return result;
+        }
+        result = hash_range(begin(), end());
+        if (is_big_) {
+            big_data_.cache_hash(result);
+        }
+        return result;
     }
 
  private:
-    void small_to_big() {
-        if (!is_big_) {
-            new (&big_data_) vector_ptr<T>(small_data_, small_data_ + size_);
-            is_big_ = true;
+    void small_to_big(size_t capacity) {
+        new (&big_data_) vector_ptr<T>(small_data_, small_data_ + size_, std::max<size_t>(capacity, size_));
+        is_big_ = true;
+    }
+
+    void big_to_small() {
+        T buf[SMALL_DATA_SIZE];
+        size_t sz = big_data_.size();
+        std::copy_n(big_data_.data(), sz, buf);
+        big_data_.~vector_ptr();
+        std::fill(std::copy_n(buf, sz, small_data_), small_data_ + SMALL_DATA_SIZE, T());
+        size_ = static_cast<unsigned char>(sz);
+        is_big_ = false;
+    }
+
+    static size_t hash_range(const_iterator first, const_iterator last) {
+        uint64_t h = 0x9E3779B97F4A7C15ULL ^ static_cast<uint64_t>(last - first);
+        for (; first != last; ++first) {
+            h = (h ^ static_cast<uint64_t>(*first)) * 0xBF58476D1CE4E5B9ULL;
+            h ^= h >> 31;
         }
+        // финальное перемешивание из splitmix64
+        h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+        h ^= h >> 31;
+        return static_cast<size_t>(h != vector_ptr<T>::NO_HASH ? h : h + 1);
     }
 
-    void init_big_data(const uint_storage<T>& src) {
+    void init_big_data(const uint_storage& src) {
         new (&big_data_) vector_ptr<T>(src.big_data_);
     }
 
-    void init_small_data(const uint_storage<T>& src) {
-        std::copy_n(src.small_data_, src.size_, small_data_);
+    void init_small_data(const uint_storage& src) {
+        // буфер небольшой и фиксированного размера, копировать его целиком быстрее, чем size_ цифр;
+        // конструкторы и big_to_small заполняют его до конца, так что неинициализированное не читается
+        std::memcpy(small_data_, src.small_data_, sizeof(small_data_));
         size_ = src.size_;
     }
 
     bool is_big_;
-    size_t size_; // значение size_ актуально только если is_big_ == false
+    unsigned char size_; // значение size_ актуально только если is_big_ == false
 
-    static constexpr size_t SMALL_DATA_SIZE = sizeof(vector_ptr<T>) / sizeof(T);
+    static constexpr size_t SMALL_DATA_SIZE = InlineSize;
 
     union {
         vector_ptr<T> big_data_;
@@ -3,18 +3,99 @@
 //
 #pragma once
 
-#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "limb_resource.h"
+
+/*
+ * Разделяемый буфер с копированием при записи. Счётчик ссылок, размер,
+ * ёмкость и сами элементы лежат в одном блоке block_, поэтому на число
+ * приходится одно выделение памяти, а счётчик находится рядом с младшими
+ * цифрами. Блок берётся из текущего limb_memory_resource потока
+ * (см. limb_resource.h) и возвращается в него же.
+ *
+ * Изменяющие методы (push_back, pop_back, resize, mutable_data)
+ * можно вызывать только после detach()
+ *
+ * С BIGINT_ATOMIC_REFCOUNT счётчик ссылок атомарен, и числа, разделяющие
+ * буфер, можно копировать и читать из разных потоков. Только в этом режиме
+ * блок хранит ещё и кэш хэша: без атомарности запись кэша из const-метода
+ * была бы гонкой между потоками, читающими копии одного числа
+ */
+
+#ifdef BIGINT_ATOMIC_REFCOUNT
+struct vector_ptr_ref_count_ {
+    explicit vector_ptr_ref_count_(size_t cnt)
+            : cnt_(cnt) { }
+
+    void add_ref() {
+        cnt_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // true, если ссылка была последней
+    bool release() {
+        return cnt_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    bool shared() const {
+        return cnt_.load(std::memory_order_acquire) > 1;
+    }
+
+ private:
+    std::atomic<size_t> cnt_;
+};
+#else
+struct vector_ptr_ref_count_ {
+    explicit vector_ptr_ref_count_(size_t cnt)
+            : cnt_(cnt) { }
+
+    void add_ref() {
+        ++cnt_;
+    }
+
+    bool release() {
+        return --cnt_ == 0;
+    }
+
+    bool shared() const {
+        return cnt_ > 1;
+    }
+
+ private:
+    size_t cnt_;
+};
+#endif
 
 template <typename T>
 struct vector_ptr {
-    vector_ptr()
-            : ptr_(new ref_data_()) { }
+    static_assert(std::is_trivially_copyable<T>::value, "vector_ptr stores raw limbs");
 
-    vector_ptr(const std::vector<T>& x = T())
-            : ptr_(new ref_data_(x)) { }
+    vector_ptr()
+            : ptr_(make_block_(get_limb_resource(), 0)) { }
 
+    // [first, last) может лежать в памяти самого vector_ptr (см. uint_storage::small_to_big),
+    // поэтому ptr_ присваивается только после копирования
     vector_ptr(const T* first, const T* last)
-            : ptr_(new ref_data_(first, last)) { }
+            : ptr_(make_copy_block_(first, last - first, last - first)) { }
+
+    // то же, но с запасом ёмкости capacity >= last - first
+    vector_ptr(const T* first, const T* last, size_t capacity)
+            : ptr_(make_copy_block_(first, last - first, capacity)) { }
+
+    vector_ptr(size_t size, const T& elem)
+            : ptr_(make_block_(get_limb_resource(), size)) {
+        std::fill(ptr_->limbs(), ptr_->limbs() + size, elem);
+        ptr_->size_ = size;
+    }
+
+    // данные только для чтения, принадлежащие owner (например, отображённый в память файл);
+    // копируются в собственный буфер при первом изменении
+    vector_ptr(const T* data, size_t size, std::shared_ptr<const void> owner)
+            : ptr_(make_view_block_(data, size, std::move(owner))) { }
 
     vector_ptr(const vector_ptr<T>& other) {
         share(other);
@@ -32,53 +113,208 @@ struct vector_ptr {
         unshare();
     }
 
-    std::vector<T>* operator->() {
-        return &ptr_->obj_;
+    size_t size() const {
+        return ptr_->size_;
+    }
+
+    size_t capacity() const {
+        return ptr_->capacity_;
     }
 
-    const std::vector<T>* operator->() const {
-        return &ptr_->obj_;
+    const T* data() const {
+        return ptr_->data_;
     }
 
-    std::vector<T>& operator*() {
-        return ptr_->obj_;
+    T* mutable_data() {
+        return ptr_->limbs();
     }
 
-    const std::vector<T>& operator*() const {
-        return ptr_->obj_;
+    void push_back(const T& elem) {
+        if (ptr_->size_ == ptr_->capacity_) {
+            reallocate_(std::max<size_t>(2 * ptr_->capacity_, 4));
+        }
+        ptr_->limbs()[ptr_->size_++] = elem;
+    }
+
+    void pop_back() {
+        --ptr_->size_;
+    }
+
+    void resize(size_t new_size) {
+        if (new_size > ptr_->capacity_) {
+            reallocate_(new_size);
+        }
+        if (new_size > ptr_->size_) {
+            std::fill(ptr_->limbs() + ptr_->size_, ptr_->limbs() + new_size, T());
+        }
+        ptr_->size_ = new_size;
+    }
+
+    void reserve(size_t new_capacity) {
+        if (new_capacity > ptr_->capacity_) {
+            reallocate_(new_capacity);
+        }
+    }
+
+    void shrink_to_fit() {
+        if (ptr_->capacity_ > usable_capacity_(ptr_->resource_, ptr_->size_)) {
+            reallocate_(ptr_->size_);
+        }
     }
 
+    // вызывается перед любым изменением данных, поэтому сбрасывает закэшированный хэш
     void detach() {
-        if (ptr_->ref_cnt_ > 1) {
-            --ptr_->ref_cnt_;
-            ptr_ = new ref_data_(ptr_->obj_);
+        if (__builtin_expect(ptr_->ref_cnt_.shared() || ptr_->is_view_, 0)) {
+            copy_();
         }
+#ifdef BIGINT_ATOMIC_REFCOUNT
+        // после detach() цифры меняются; у свежей копии кэш и так пуст, а лишней записи в нехэшированный блок нет
+        if (ptr_->hash_.load(std::memory_order_relaxed) != NO_HASH) {
+            ptr_->hash_.store(NO_HASH, std::memory_order_relaxed);
+        }
+#endif
+    }
+
+    /*
+     * С BIGINT_ATOMIC_REFCOUNT хэш хранится в общем блоке, поэтому копии,
+     * разделяющие буфер, считают его один раз; иначе кэша нет, и хэш
+     * считается по цифрам при каждом вызове. Значение NO_HASH означает,
+     * что хэш не посчитан, и не может быть закэшировано
+     */
+    static const size_t NO_HASH = 0;
+
+#ifdef BIGINT_ATOMIC_REFCOUNT
+    bool cached_hash(size_t& hash) const {
+        hash = ptr_->hash_.load(std::memory_order_relaxed);
+        return hash != NO_HASH;
+    }
+
+    void cache_hash(size_t hash) const {
+        ptr_->hash_.store(hash, std::memory_order_relaxed);
+    }
+#else
+    bool cached_hash(size_t&) const {
+        return false;
     }
 
+    void cache_hash(size_t) const { }
+#endif
+
  private:
+    struct view_data_ {
+        std::shared_ptr<const void> owner;
+    };
+
+    /*
+     * За заголовком следуют capacity_ элементов, либо view_data_, если is_view_.
+     * data_ указывает на цифры -- свои или чужие, -- чтобы чтение обходилось без ветвления
+     */
+    struct block_ {
+        const T* data_;
+        vector_ptr_ref_count_ ref_cnt_;
+        size_t size_;
+        size_t capacity_;
+        limb_memory_resource* resource_;
+#ifdef BIGINT_ATOMIC_REFCOUNT
+        std::atomic<size_t> hash_;
+#endif
+        bool is_view_;
+
+#ifdef BIGINT_ATOMIC_REFCOUNT
+        explicit block_(limb_memory_resource* resource)
+                : data_(limbs()), ref_cnt_(1), size_(0), capacity_(0), resource_(resource), hash_(NO_HASH),
+                  is_view_(false) { }
+#else
+        explicit block_(limb_memory_resource* resource)
+                : data_(limbs()), ref_cnt_(1), size_(0), capacity_(0), resource_(resource), is_view_(false) { }
+#endif
+
+        T* limbs() {
+            return reinterpret_cast<T*>(this + 1);
+        }
+
+        view_data_* view() {
+            return reinterpret_cast<view_data_*>(this + 1);
+        }
+
+        size_t bytes() const {
+            return sizeof(block_) + (is_view_ ? sizeof(view_data_) : capacity_ * sizeof(T));
+        }
+    };
+
+    static block_* allocate_block_(limb_memory_resource* resource, size_t payload) {
+        void* mem = resource->allocate(sizeof(block_) + payload, alignof(block_));
+        return new (mem) block_(resource);
+    }
+
+    // ёмкость блока под capacity цифр с учётом того, сколько источник выдаёт на самом деле
+    static size_t usable_capacity_(limb_memory_resource* resource, size_t capacity) {
+        size_t bytes = resource->usable_size(sizeof(block_) + capacity * sizeof(T), alignof(block_));
+        return (bytes - sizeof(block_)) / sizeof(T);
+    }
+
+    static block_* make_block_(limb_memory_resource* resource, size_t capacity) {
+        capacity = usable_capacity_(resource, capacity);
+        block_* block = allocate_block_(resource, capacity * sizeof(T));
+        block->capacity_ = capacity;
+        return block;
+    }
+
+    static block_* make_copy_block_(const T* data, size_t size, size_t capacity) {
+        block_* block = make_block_(get_limb_resource(), capacity);
+        std::memcpy(block->limbs(), data, size * sizeof(T));
+        block->size_ = size;
+        return block;
+    }
+
+    static block_* make_view_block_(const T* data, size_t size, std::shared_ptr<const void> owner) {
+        block_* block = allocate_block_(get_limb_resource(), sizeof(view_data_));
+        block->size_ = size;
+        block->is_view_ = true;
+        block->data_ = data;
+        new (block->view()) view_data_{std::move(owner)};
+        return block;
+    }
+
+    static void destroy_block_(block_* block) {
+        if (block->is_view_) {
+            block->view()->~view_data_();
+        }
+        limb_memory_resource* resource = block->resource_;
+        size_t bytes = block->bytes();
+        block->~block_();
+        resource->deallocate(block, bytes, alignof(block_));
+    }
+
+    // блок принадлежит только нам: переносим цифры в блок большей ёмкости того же источника
+    void reallocate_(size_t new_capacity) {
+        block_* block = make_block_(ptr_->resource_, new_capacity);
+        std::memcpy(block->limbs(), ptr_->limbs(), ptr_->size_ * sizeof(T));
+        block->size_ = ptr_->size_;
+        destroy_block_(ptr_);
+        ptr_ = block;
+    }
+
+    // медленный путь detach() вынесен, чтобы сама проверка встраивалась в циклы по цифрам
+    __attribute__((noinline)) void copy_() {
+        block_* block = make_copy_block_(data(), size(), size());
+        unshare();
+        ptr_ = block;
+    }
+
     void unshare() {
-        --ptr_->ref_cnt_;
-        if (ptr_->ref_cnt_ == 0) {
-            delete ptr_;
+        if (ptr_->ref_cnt_.release()) {
+            destroy_block_(ptr_);
         }
     }
 
     void share(const vector_ptr<T>& other) {
         ptr_ = other.ptr_;
-        ++ptr_->ref_cnt_;
+        ptr_->ref_cnt_.add_ref();
     }
 
-    struct ref_data_ {
-        std::vector<T> obj_;
-        size_t ref_cnt_;
-
-        ref_data_()
-                : obj_(), ref_cnt_(1) { }
+    block_* ptr_;
+};
 
-        explicit ref_data_(const std::vector<T>& other)
-                : obj_(other), ref_cnt_(1) { }
-
-        ref_data_(const T* first, const T* last)
-                : obj_(first, last), ref_cnt_(1) { }
-    } *ptr_;
-};
\ No newline at end of file
+template <typename T>
+const size_t vector_ptr<T>::NO_HASH;